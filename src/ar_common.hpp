@@ -0,0 +1,167 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Helpers shared by the AR programs: calibration loading, OBJ loading,
+// board geometry and wireframe drawing.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Loads the camera matrix and distortion coefficients written by main.cpp.
+inline bool loadIntrinsics(const std::string& path, cv::Mat& cameraMatrix, cv::Mat& distCoeffs) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Could not open calibration file " << path << std::endl;
+        return false;
+    }
+    fs["CameraMatrix"] >> cameraMatrix;
+    fs["DistortionCoefficients"] >> distCoeffs;
+    fs.release();
+    return !cameraMatrix.empty();
+}
+
+// -----------------------------------------------------------------------------
+// OBJ loader: loads vertices and faces (triangles and quads) from an OBJ file.
+inline bool loadOBJ(const std::string& objFilePath, std::vector<cv::Point3f>& outVertices,
+                    std::vector<cv::Vec3i>& outFaces) {
+    std::ifstream file(objFilePath);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open OBJ file: " << objFilePath << std::endl;
+        return false;
+    }
+    std::cout << "Loading OBJ file: " << objFilePath << std::endl;
+    outVertices.clear();
+    outFaces.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty())
+            continue;
+        if (line.substr(0, 2) == "v ") { // Vertex line: "v x y z"
+            std::istringstream iss(line);
+            char vLabel;
+            float x, y, z;
+            if (!(iss >> vLabel >> x >> y >> z)) {
+                std::cerr << "Error parsing vertex: " << line << std::endl;
+                continue;
+            }
+            outVertices.push_back(cv::Point3f(x, y, z));
+        } else if (line.substr(0, 2) == "f ") { // Face line: "f idx/idx/idx ..."
+            std::istringstream iss(line);
+            char fLabel;
+            iss >> fLabel; // skip 'f'
+            std::vector<int> vertexIndices;
+            std::string token;
+            while (iss >> token) {
+                std::istringstream tokenStream(token);
+                std::string indexStr;
+                if (std::getline(tokenStream, indexStr, '/')) {
+                    try {
+                        vertexIndices.push_back(std::stoi(indexStr) - 1); // convert to 0-based
+                    } catch (std::exception&) {
+                        std::cerr << "Error converting token to integer: " << token << std::endl;
+                    }
+                }
+            }
+            if (vertexIndices.size() == 3) {
+                outFaces.push_back(cv::Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
+            } else if (vertexIndices.size() == 4) {
+                outFaces.push_back(cv::Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
+                outFaces.push_back(cv::Vec3i(vertexIndices[0], vertexIndices[2], vertexIndices[3]));
+            } else {
+                std::cerr << "Face with unsupported number of vertices: " << vertexIndices.size() << std::endl;
+            }
+        }
+    }
+    std::cout << "OBJ loaded: " << outVertices.size() << " vertices, " << outFaces.size() << " faces." << std::endl;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Scales/translates the model so it appears above the board.
+inline void adjustModel(std::vector<cv::Point3f>& vertices, float scale, float zOffset) {
+    for (auto &v : vertices) {
+        v.x *= scale;
+        v.y *= scale;
+        v.z *= scale;
+        v.z += zOffset;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// 3D world coordinates of the board corners: plane z=0, top-left at (0,0,0),
+// one unit per square, rows going towards -y (same convention as main.cpp).
+inline std::vector<cv::Point3f> makeBoardObjectPoints(cv::Size patternSize) {
+    std::vector<cv::Point3f> points;
+    for (int i = 0; i < patternSize.height; i++)
+        for (int j = 0; j < patternSize.width; j++)
+            points.push_back(cv::Point3f((float)j, (float)-i, 0));
+    return points;
+}
+
+// -----------------------------------------------------------------------------
+// Draws triangle edges of a projected mesh, skipping faces with bad indices.
+// faceStride > 1 draws only every n-th face (coarser, cheaper wireframe).
+inline void drawWireframe(cv::Mat& frame, const std::vector<cv::Point2f>& projectedPoints,
+                          const std::vector<cv::Vec3i>& faces, const cv::Scalar& color, int thickness,
+                          int faceStride = 1) {
+    const int n = (int)projectedPoints.size();
+    faceStride = std::max(1, faceStride);
+    for (size_t i = 0; i < faces.size(); i += faceStride) {
+        const cv::Vec3i &f = faces[i];
+        if (f[0] < 0 || f[0] >= n || f[1] < 0 || f[1] >= n || f[2] < 0 || f[2] >= n)
+            continue;
+        cv::line(frame, projectedPoints[f[0]], projectedPoints[f[1]], color, thickness);
+        cv::line(frame, projectedPoints[f[1]], projectedPoints[f[2]], color, thickness);
+        cv::line(frame, projectedPoints[f[2]], projectedPoints[f[0]], color, thickness);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Pixel rectangle covering lines of the given thickness drawn between points
+// inside [lo, hi]; a segment never leaves the box of its end points. Empty
+// if lo > hi (nothing drawn). Far off-screen points are clamped so the
+// rectangle stays representable; callers clip it to the image.
+inline cv::Rect drawnBounds(cv::Point2f lo, cv::Point2f hi, int thickness) {
+    if (!(lo.x <= hi.x && lo.y <= hi.y))
+        return cv::Rect();
+    const float limit = 1e6f, pad = (float)thickness + 2.0f;
+    auto clampTo = [&](float v) { return (int)std::floor(std::max(-limit, std::min(limit, v))); };
+    return cv::Rect(cv::Point(clampTo(lo.x - pad), clampTo(lo.y - pad)),
+                    cv::Point(clampTo(hi.x + pad) + 1, clampTo(hi.y + pad) + 1));
+}
+
+inline void growBounds(cv::Point2f& lo, cv::Point2f& hi, const cv::Point2f& p) {
+    lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y);
+    hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y);
+}
+
+// cv::drawFrameAxes that also returns the rectangle it drew into.
+inline cv::Rect drawAxes(cv::Mat& image, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs,
+                         const cv::Mat& rvec, const cv::Mat& tvec, float length, int thickness = 3) {
+    cv::drawFrameAxes(image, cameraMatrix, distCoeffs, rvec, tvec, length, thickness);
+    const std::vector<cv::Point3f> ends = {cv::Point3f(0, 0, 0), cv::Point3f(length, 0, 0),
+                                           cv::Point3f(0, length, 0), cv::Point3f(0, 0, length)};
+    std::vector<cv::Point2f> projected;
+    cv::projectPoints(ends, rvec, tvec, cameraMatrix, distCoeffs, projected);
+    cv::Point2f lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+    for (const cv::Point2f &p : projected)
+        growBounds(lo, hi, p);
+    return drawnBounds(lo, hi, thickness);
+}
@@ -0,0 +1,161 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Per-stream checkerboard tracker used by the multi-stream engine.
+// It is the detect/track state machine from extension.cpp applied to the
+// 9x6 board: detect with findChessboardCorners, follow the corners with
+// optical flow, and fall back to detection when tracking is lost.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "ar_common.hpp"
+#include "corner_refine.hpp"
+#include "quality_governor.hpp"
+
+// Tracking state reported for every frame.
+enum class TrackState { Lost = 0, Detected = 1, Tracked = 2 };
+
+// -----------------------------------------------------------------------------
+// Read-only data shared by every stream. Loaded once and handed out as
+// shared_ptr<const ...> so worker threads never copy or mutate it.
+struct CameraIntrinsics {
+    cv::Mat cameraMatrix;
+    cv::Mat distCoeffs;
+};
+
+struct MeshAsset {
+    std::vector<cv::Point3f> vertices;
+    std::vector<cv::Vec3i> faces;
+};
+
+// -----------------------------------------------------------------------------
+// Result of processing one frame.
+struct FrameResult {
+    TrackState state = TrackState::Lost;
+    std::vector<cv::Point2f> corners;
+    cv::Mat rvec, tvec;
+    bool poseValid = false;
+};
+
+// -----------------------------------------------------------------------------
+class BoardTracker {
+public:
+    BoardTracker(std::shared_ptr<const CameraIntrinsics> intrinsics,
+                 std::shared_ptr<const MeshAsset> mesh,
+                 cv::Size patternSize = cv::Size(9, 6))
+        : intrinsics_(std::move(intrinsics)), mesh_(std::move(mesh)), patternSize_(patternSize),
+          boardObjectPoints_(makeBoardObjectPoints(patternSize)) {}
+
+    // Force a full detection every N tracked frames to stop optical flow drift.
+    void setRedetectInterval(int frames) { redetectInterval_ = frames; }
+
+    // Detection scale, refinement iterations, re-detection interval and
+    // wireframe detail from a QualityGovernor level.
+    void applyQuality(const QualitySettings& q) {
+        detectScale_ = q.detectScale;
+        refineParams_.maxIterations = q.refineIterations;
+        redetectInterval_ = q.redetectInterval;
+        faceStride_ = q.faceStride;
+    }
+
+    // Processes one frame. If 'draw' is set, the corners, axes and model
+    // wireframe are drawn onto 'frame'.
+    FrameResult process(cv::Mat& frame, bool draw) {
+        FrameResult result;
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+
+        bool needDetect = !isTracking_ ||
+            (redetectInterval_ > 0 && framesSinceDetect_ >= redetectInterval_);
+
+        if (isTracking_ && !needDetect) {
+            // Follow the corners from the previous frame with optical flow.
+            std::vector<cv::Point2f> newCorners;
+            std::vector<uchar> status;
+            std::vector<float> err;
+            cv::calcOpticalFlowPyrLK(prevGray_, gray, corners_, newCorners, status, err);
+            bool allTracked = status.size() == corners_.size();
+            for (uchar s : status)
+                allTracked = allTracked && s;
+            if (allTracked) {
+                corners_ = newCorners;
+                result.state = TrackState::Tracked;
+                framesSinceDetect_++;
+            } else {
+                isTracking_ = false;
+                needDetect = true;
+            }
+        }
+
+        if (needDetect) {
+            std::vector<cv::Point2f> found;
+            if (findBoardCorners(gray, patternSize_, found, detectScale_, refineParams_)) {
+                corners_ = found;
+                isTracking_ = true;
+                framesSinceDetect_ = 0;
+                result.state = TrackState::Detected;
+            } else {
+                isTracking_ = false;
+                corners_.clear();
+            }
+        }
+        prevGray_ = gray;
+
+        if (!isTracking_)
+            return result;
+
+        result.corners = corners_;
+        try {
+            result.poseValid = cv::solvePnP(boardObjectPoints_, corners_, intrinsics_->cameraMatrix,
+                                            intrinsics_->distCoeffs, result.rvec, result.tvec);
+        } catch (const cv::Exception& e) {
+            // Runs on pool and segment threads, where an escaping exception
+            // would end the process. The frame is lost; detect again next time.
+            std::cerr << "Exception in solvePnP: " << e.what() << std::endl;
+            isTracking_ = false;
+            result = FrameResult();
+            return result;
+        }
+        if (draw) {
+            cv::drawChessboardCorners(frame, patternSize_, cv::Mat(corners_), true);
+            if (result.poseValid) {
+                cv::drawFrameAxes(frame, intrinsics_->cameraMatrix, intrinsics_->distCoeffs,
+                                  result.rvec, result.tvec, 3);
+                if (mesh_ && !mesh_->vertices.empty()) {
+                    cv::projectPoints(mesh_->vertices, result.rvec, result.tvec,
+                                      intrinsics_->cameraMatrix, intrinsics_->distCoeffs, projected_);
+                    drawWireframe(frame, projected_, mesh_->faces, cv::Scalar(255, 255, 255), 2, faceStride_);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    std::shared_ptr<const CameraIntrinsics> intrinsics_;
+    std::shared_ptr<const MeshAsset> mesh_;
+    cv::Size patternSize_;
+    std::vector<cv::Point3f> boardObjectPoints_;
+
+    bool isTracking_ = false;
+    int framesSinceDetect_ = 0;
+    int redetectInterval_ = 30;
+    double detectScale_ = 1.0;
+    CornerRefineParams refineParams_;
+    int faceStride_ = 1;
+    std::vector<cv::Point2f> corners_;
+    cv::Mat prevGray_;
+    std::vector<cv::Point2f> projected_; // scratch buffer reused across frames
+};
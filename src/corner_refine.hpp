@@ -0,0 +1,219 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Batched sub-pixel refinement for checkerboard corners, replacing
+// cornerSubPix(gray, corners, Size(11, 11), Size(-1, -1), 30 iterations, eps 0.1).
+//
+// Same estimator as cornerSubPix: at the true corner q, every image gradient
+// g_p in the window is orthogonal to (q - p), so q = (sum w g g^T)^-1 sum w g g^T p
+// with Gaussian weights w centred on the current estimate. Differences:
+//  - gradients and their products (Ixx, Ixy, Iyy) are computed once for the
+//    bounding box of all corners with OpenCV's vectorized filters, instead
+//    of resampling an 11x11 patch per corner per iteration;
+//  - the window is scaled to the measured square size of the board, so
+//    small boards do not mix in neighbouring corners and large boards get
+//    more support;
+//  - every corner stops on its own as soon as its update is below eps;
+//  - corners can optionally be spread across threads.
+// refine_bench.cpp checks the accuracy against cornerSubPix on synthetic boards.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+struct CornerRefineParams {
+    int maxIterations = 30;
+    double eps = 0.1;             // stop when the update is below eps pixels
+    double windowFraction = 0.4;  // half window = fraction * square size
+    int minHalfWindow = 2;
+    int maxHalfWindow = 10;
+    int fixedHalfWindow = 0;      // > 0 overrides the adaptive window
+    bool parallel = false;        // spread corners over OpenCV's thread pool
+};
+
+struct CornerRefineStats {
+    int halfWindow = 0;
+    int totalIterations = 0;
+    int converged = 0;            // corners that met eps before maxIterations
+};
+
+// -----------------------------------------------------------------------------
+// Median distance between neighbouring corners of a row-major grid, in pixels.
+inline double measureSquareSize(const std::vector<cv::Point2f>& corners, cv::Size patternSize) {
+    std::vector<double> d;
+    if ((int)corners.size() != patternSize.area())
+        return 0.0;
+    for (int r = 0; r < patternSize.height; r++) {
+        for (int c = 0; c < patternSize.width; c++) {
+            const cv::Point2f &p = corners[r * patternSize.width + c];
+            if (c + 1 < patternSize.width)
+                d.push_back(cv::norm(corners[r * patternSize.width + c + 1] - p));
+            if (r + 1 < patternSize.height)
+                d.push_back(cv::norm(corners[(r + 1) * patternSize.width + c] - p));
+        }
+    }
+    if (d.empty())
+        return 0.0;
+    std::nth_element(d.begin(), d.begin() + d.size() / 2, d.end());
+    return d[d.size() / 2];
+}
+
+// -----------------------------------------------------------------------------
+// Refines 'corners' in place. 'gray' is the 8-bit image they were found in;
+// patternSize is used to measure the square size (pass Size() to use
+// fixedHalfWindow or the 5 px default of an 11x11 window).
+inline CornerRefineStats refineCorners(const cv::Mat& gray, std::vector<cv::Point2f>& corners,
+                                       cv::Size patternSize, const CornerRefineParams& params = CornerRefineParams()) {
+    CornerRefineStats stats;
+    if (corners.empty() || gray.empty())
+        return stats;
+
+    int h = params.fixedHalfWindow;
+    if (h <= 0) {
+        double square = patternSize.area() > 0 ? measureSquareSize(corners, patternSize) : 0.0;
+        h = square > 0 ? (int)std::lround(params.windowFraction * square) : 5;
+        h = std::max(params.minHalfWindow, std::min(params.maxHalfWindow, h));
+    }
+    stats.halfWindow = h;
+
+    // One region covering every window (plus the 1 px gradient border).
+    float minX = corners[0].x, maxX = corners[0].x, minY = corners[0].y, maxY = corners[0].y;
+    for (const auto &p : corners) {
+        minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+    }
+    const int margin = 2 * h + 2; // corners may move up to h before being rejected
+    cv::Rect roi(cvFloor(minX) - margin, cvFloor(minY) - margin,
+                 cvCeil(maxX) - cvFloor(minX) + 2 * margin + 1, cvCeil(maxY) - cvFloor(minY) + 2 * margin + 1);
+    roi &= cv::Rect(0, 0, gray.cols, gray.rows);
+    if (roi.width < 3 || roi.height < 3)
+        return stats;
+
+    // Central-difference gradients (Sobel ksize 1 is [-1 0 1], as in
+    // cornerSubPix) and their products, once for the whole batch.
+    cv::Mat gx, gy, ixx, ixy, iyy;
+    cv::Sobel(gray(roi), gx, CV_32F, 1, 0, 1);
+    cv::Sobel(gray(roi), gy, CV_32F, 0, 1, 1);
+    cv::multiply(gx, gx, ixx);
+    cv::multiply(gx, gy, ixy);
+    cv::multiply(gy, gy, iyy);
+
+    const int win = 2 * h + 1;
+    const double coeff = 1.0 / (h * h);     // same falloff as cornerSubPix's mask
+    const double eps2 = params.eps * params.eps;
+    std::vector<int> iterations(corners.size(), 0);
+    std::vector<unsigned char> converged(corners.size(), 0);
+
+    auto refineRange = [&](const cv::Range& range) {
+        std::vector<float> wx(win), xs(win);
+        for (int k = range.start; k < range.end; k++) {
+            const cv::Point2d start(corners[k].x - roi.x, corners[k].y - roi.y);
+            cv::Point2d q = start;
+            int it = 0;
+            bool done = false;
+            while (it < params.maxIterations) {
+                const int cx = cvRound(q.x), cy = cvRound(q.y);
+                if (cx - h < 1 || cy - h < 1 || cx + h >= roi.width - 1 || cy + h >= roi.height - 1)
+                    break; // window would leave the valid gradient area
+                it++;
+
+                // Positions are taken relative to the window centre (cx, cy)
+                // to keep the float sums well conditioned.
+                const double fx = q.x - cx, fy = q.y - cy;
+                for (int i = 0; i < win; i++) {
+                    const double x = i - h;
+                    xs[i] = (float)x;
+                    wx[i] = (float)std::exp(-(x - fx) * (x - fx) * coeff);
+                }
+
+                // Row sums are contiguous float loops the compiler vectorizes.
+                double a = 0, b = 0, c = 0, bb1 = 0, bb2 = 0;
+                for (int j = 0; j < win; j++) {
+                    const double y = j - h;
+                    const double wy = std::exp(-(y - fy) * (y - fy) * coeff);
+                    const float* pxx = ixx.ptr<float>(cy - h + j) + cx - h;
+                    const float* pxy = ixy.ptr<float>(cy - h + j) + cx - h;
+                    const float* pyy = iyy.ptr<float>(cy - h + j) + cx - h;
+                    float sxx = 0, sxy = 0, syy = 0, sxxX = 0, sxyX = 0;
+                    for (int i = 0; i < win; i++) {
+                        const float w = wx[i], wxv = wx[i] * xs[i];
+                        sxx += w * pxx[i];
+                        sxy += w * pxy[i];
+                        syy += w * pyy[i];
+                        sxxX += wxv * pxx[i];
+                        sxyX += wxv * pxy[i];
+                    }
+                    a += wy * sxx;
+                    b += wy * sxy;
+                    c += wy * syy;
+                    bb1 += wy * (sxxX + y * sxy);
+                    bb2 += wy * (sxyX + y * syy);
+                }
+
+                const double det = a * c - b * b;
+                if (std::fabs(det) <= DBL_EPSILON * DBL_EPSILON)
+                    break; // flat window, nothing to solve
+                const cv::Point2d next(cx + (c * bb1 - b * bb2) / det, cy + (a * bb2 - b * bb1) / det);
+                const double dx = next.x - q.x, dy = next.y - q.y;
+                q = next;
+                if (dx * dx + dy * dy <= eps2) {
+                    done = true;
+                    break;
+                }
+            }
+            // Like cornerSubPix: a corner that wandered out of its window is not trusted.
+            if (std::fabs(q.x - start.x) > h || std::fabs(q.y - start.y) > h)
+                q = start;
+            corners[k] = cv::Point2f((float)(q.x + roi.x), (float)(q.y + roi.y));
+            iterations[k] = it;
+            converged[k] = done;
+        }
+    };
+
+    const cv::Range all(0, (int)corners.size());
+    if (params.parallel)
+        cv::parallel_for_(all, refineRange);
+    else
+        refineRange(all);
+
+    for (size_t k = 0; k < corners.size(); k++) {
+        stats.totalIterations += iterations[k];
+        stats.converged += converged[k];
+    }
+    return stats;
+}
+
+// -----------------------------------------------------------------------------
+// Checkerboard detection as in the demos (adaptive threshold, normalize, fast
+// check). With detectScale < 1 the detector runs on a downscaled copy and the
+// corners are refined at full resolution, so accuracy is kept while the
+// expensive part gets cheaper.
+inline bool findBoardCorners(const cv::Mat& gray, cv::Size patternSize, std::vector<cv::Point2f>& corners,
+                             double detectScale = 1.0, const CornerRefineParams& params = CornerRefineParams()) {
+    const int flags = cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE | cv::CALIB_CB_FAST_CHECK;
+    bool found;
+    if (detectScale > 0 && detectScale < 1.0) {
+        cv::Mat small;
+        cv::resize(gray, small, cv::Size(), detectScale, detectScale, cv::INTER_AREA);
+        found = cv::findChessboardCorners(small, patternSize, corners, flags);
+        for (auto &p : corners)
+            p = cv::Point2f((float)((p.x + 0.5) / detectScale - 0.5), (float)((p.y + 0.5) / detectScale - 0.5));
+    } else {
+        found = cv::findChessboardCorners(gray, patternSize, corners, flags);
+    }
+    if (!found || (int)corners.size() != patternSize.area())
+        return false;
+    refineCorners(gray, corners, patternSize, params);
+    return true;
+}
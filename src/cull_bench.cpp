@@ -0,0 +1,148 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Cost of projecting and drawing a large scene with and without frustum
+// culling (SceneProjector, mesh_bvh.hpp), from an overview down to close-ups
+// where only a corner of the model is in view.
+//
+// The default model is a terrain grid over the board with 2 * grid^2
+// triangles. --model renders an OBJ instead, scaled and raised like
+// read_obj does. Both paths draw into their own frame and the frames are
+// compared: culling must not change a single pixel.
+//
+// Usage: cullbench [--grid n] [--model file.obj [--scale s] [--z z]] [--iterations n]
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scene.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Terrain over the 9x6 board (x in [0, 8], y in [-5, 0]), gently curved so
+// the boxes are not flat.
+static void makeTerrainScene(int grid, Scene& scene) {
+    scene = Scene();
+    SceneMesh mesh;
+    mesh.name = "terrain";
+    for (int r = 0; r <= grid; r++) {
+        for (int c = 0; c <= grid; c++) {
+            float x = 8.0f * c / grid, y = -5.0f * r / grid;
+            mesh.vertices.push_back(Point3f(x, y, 0.5f + 0.3f * sin(2.0f * x) * cos(3.0f * y)));
+        }
+    }
+    for (int r = 0; r < grid; r++) {
+        for (int c = 0; c < grid; c++) {
+            int v = r * (grid + 1) + c;
+            mesh.faces.push_back(Vec3i(v, v + 1, v + grid + 2));
+            mesh.faces.push_back(Vec3i(v, v + grid + 2, v + grid + 1));
+        }
+    }
+    prepareMesh(mesh);
+    scene.meshes.push_back(std::move(mesh));
+    scene.instances.push_back(SceneInstance());
+}
+
+// Board pose for a camera at 'center' (board units) looking down at the
+// board, tilted by 'tiltDeg' about its own x axis.
+static void lookDown(Point3d center, double tiltDeg, Mat& rvec, Mat& tvec) {
+    const double a = tiltDeg * CV_PI / 180.0;
+    Matx33d flip(1, 0, 0, 0, -1, 0, 0, 0, -1);
+    Matx33d tilt(1, 0, 0, 0, cos(a), -sin(a), 0, sin(a), cos(a));
+    Matx33d R = tilt * flip;
+    Vec3d t = -(R * Vec3d(center.x, center.y, center.z));
+    Rodrigues(Mat(R), rvec);
+    tvec = (Mat_<double>(3, 1) << t[0], t[1], t[2]);
+}
+
+struct Pose {
+    string name;
+    Point3d center;
+    double tiltDeg;
+};
+
+int main(int argc, char** argv)
+{
+    int grid = 1000, iterations = 10;
+    string modelPath;
+    float scale = 1.0f, zOffset = 5.0f;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--grid") grid = max(1, atoi(argv[i + 1]));
+        else if (arg == "--model") modelPath = argv[i + 1];
+        else if (arg == "--scale") scale = (float)atof(argv[i + 1]);
+        else if (arg == "--z") zOffset = (float)atof(argv[i + 1]);
+        else if (arg == "--iterations") iterations = max(1, atoi(argv[i + 1]));
+    }
+
+    Scene scene;
+    auto t0 = chrono::steady_clock::now();
+    if (modelPath.empty())
+        makeTerrainScene(grid, scene);
+    else if (!makeSingleModelScene(modelPath, scale, zOffset, scene))
+        return -1;
+    const double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    const MeshBVH &bvh = scene.meshes[0].bvh;
+    cout << scene.meshes[0].faces.size() << " triangles, " << scene.meshes[0].vertices.size() << " vertices, "
+         << bvh.numNodes() << " BVH nodes (load + build " << fixed << setprecision(1) << buildMs << " ms)" << endl;
+
+    // 1280x720 camera with barrel distortion, so the frustum comes from the
+    // undistorted image border rather than the pinhole rectangle.
+    const Size imageSize(1280, 720);
+    Mat cameraMatrix = (Mat_<double>(3, 3) << 900, 0, 640, 0, 900, 360, 0, 0, 1);
+    Mat distCoeffs = (Mat_<double>(5, 1) << -0.2, 0.05, 0, 0, 0);
+
+    const vector<Pose> poses = {
+        {"overview", Point3d(4, -2.5, 12), 0},
+        {"close-up", Point3d(2, -1, 1.5), 0},
+        {"very close, tilted", Point3d(2, -1, 0.9), 30},
+        {"board edge", Point3d(-1, -2.5, 2), -20},
+        {"looking away", Point3d(4, -2.5, 3), 100},
+    };
+
+    SceneProjector full, culled;
+    full.setCulling(false);
+    cout << left << setw(22) << "pose" << right << setw(12) << "visible %" << setw(12) << "full ms"
+         << setw(12) << "culled ms" << setw(10) << "speedup" << setw(10) << "diff px" << endl;
+    for (const Pose &pose : poses) {
+        Mat rvec, tvec;
+        lookDown(pose.center, pose.tiltDeg, rvec, tvec);
+        Mat frameFull(imageSize, CV_8UC3), frameCulled(imageSize, CV_8UC3);
+        double msFull = 0, msCulled = 0;
+        for (int it = 0; it < iterations; it++) {
+            frameFull.setTo(Scalar::all(0));
+            auto a = chrono::steady_clock::now();
+            full.project(scene, rvec, tvec, cameraMatrix, distCoeffs);
+            full.draw(frameFull, scene, Scalar(255, 255, 255), 2);
+            auto b = chrono::steady_clock::now();
+            frameCulled.setTo(Scalar::all(0));
+            culled.project(scene, rvec, tvec, cameraMatrix, distCoeffs, imageSize);
+            culled.draw(frameCulled, scene, Scalar(255, 255, 255), 2);
+            auto c = chrono::steady_clock::now();
+            msFull += chrono::duration<double, milli>(b - a).count();
+            msCulled += chrono::duration<double, milli>(c - b).count();
+        }
+        Mat diff;
+        absdiff(frameFull, frameCulled, diff);
+        cvtColor(diff, diff, COLOR_BGR2GRAY);
+        const double visible = 100.0 * culled.visibleTriangles() / max<size_t>(1, culled.totalTriangles());
+        cout << left << setw(22) << pose.name << right << fixed << setprecision(1) << setw(12) << visible
+             << setprecision(2) << setw(12) << msFull / iterations << setw(12) << msCulled / iterations
+             << setw(9) << msFull / max(1e-9, msCulled) << "x" << setw(10) << countNonZero(diff) << endl;
+    }
+    return 0;
+}
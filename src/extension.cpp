@@ -11,84 +11,21 @@ Project 4 - Calibration and Augmented Reality
 #include <opencv2/opencv.hpp>
 #include <opencv2/calib3d.hpp>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <limits>
 
+#include "ar_common.hpp"
+#include "latest_frame.hpp"
+#include "overlay_cache.hpp"
+#include "pose_shm.hpp"
+#include "scene.hpp"
+#include "trajectory_log.hpp"
+
 using namespace cv;
 using namespace std;
 
-// -----------------------------------------------------------------------------
-// OBJ loader: loads vertices and faces from an OBJ file.
-bool loadOBJ(const string& objFilePath, vector<Point3f>& outVertices, vector<Vec3i>& outFaces) {
-    ifstream file(objFilePath);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open OBJ file: " << objFilePath << endl;
-        return false;
-    }
-    cout << "Loading OBJ file: " << objFilePath << endl;
-    outVertices.clear();
-    outFaces.clear();
-    string line;
-    while (getline(file, line)) {
-        if (line.empty())
-            continue;
-        if (line.substr(0, 2) == "v ") { // Vertex line: "v x y z"
-            istringstream iss(line);
-            char vLabel;
-            float x, y, z;
-            if (!(iss >> vLabel >> x >> y >> z)) {
-                cerr << "Error parsing vertex: " << line << endl;
-                continue;
-            }
-            outVertices.push_back(Point3f(x, y, z));
-        } else if (line.substr(0, 2) == "f ") { // Face line: "f idx/idx/idx ..."
-            istringstream iss(line);
-            char fLabel;
-            iss >> fLabel; // skip 'f'
-            vector<int> vertexIndices;
-            string token;
-            while (iss >> token) {
-                istringstream tokenStream(token);
-                string indexStr;
-                if (getline(tokenStream, indexStr, '/')) {
-                    try {
-                        int index = stoi(indexStr);
-                        vertexIndices.push_back(index - 1); // convert to 0-based
-                    } catch (exception& e) {
-                        cerr << "Error converting token to integer: " << token << endl;
-                    }
-                }
-            }
-            if (vertexIndices.size() == 3) {
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
-            } else if (vertexIndices.size() == 4) {
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[2], vertexIndices[3]));
-            } else {
-                cerr << "Face with unsupported number of vertices: " << vertexIndices.size() << endl;
-            }
-        }
-    }
-    file.close();
-    cout << "OBJ loaded: " << outVertices.size() << " vertices, " << outFaces.size() << " faces." << endl;
-    return true;
-}
-
-// -----------------------------------------------------------------------------
-// Adjusts (scales/translates) the model so it appears above the target.
-void adjustModel(vector<Point3f>& vertices, float scale, float zOffset) {
-    for (auto &v : vertices) {
-        v.x *= scale;
-        v.y *= scale;
-        v.z *= scale;
-        v.z += zOffset;
-    }
-}
-
 // -----------------------------------------------------------------------------
 // Orders 4 points into a consistent order: top-left, top-right, bottom-right, bottom-left.
 vector<Point2f> orderPoints(vector<Point2f> pts) {
@@ -166,7 +103,7 @@ bool detectTarget(const Mat &frame, vector<Point2f> &targetCorners) {
 // -----------------------------------------------------------------------------
 // Main: Uses a state machine that first detects a rectangle target, then
 // tracks its corners using optical flow. If tracking fails, it reverts to detection.
-int main() {
+int main(int argc, char** argv) {
     // Load calibration parameters.
     FileStorage fs("../calibration/intrinsics.yaml", FileStorage::READ);
     if (!fs.isOpened()){
@@ -188,40 +125,108 @@ int main() {
         Point3f(0, 6, 0)     // bottom-left
     };
     
-    // Load the OBJ model.
-    string objFilePath = "../models/newcar.obj";
-    vector<Point3f> objVertices;
-    vector<Vec3i> objFaces;
-    if (!loadOBJ(objFilePath, objVertices, objFaces))
+    // Options:
+    //   --scene <file>        render an instanced scene (see scene.hpp)
+    //   --publish [name]      publish every pose to shared memory (see pose_shm.hpp)
+    //   --record <log>        write a trajectory log for the replay tool
+    //   --record-video <file> save the raw camera frames next to the log
+    //   --low-latency         capture on its own thread, always process the newest frame
+    //   --no-overlay-cache    redraw the overlay every frame even when the pose is unchanged
+    //   --no-cull             project and draw the whole scene, also the parts outside the image
+    PoseShmWriter poseWriter;
+    TrajectoryLogWriter trajectoryLog;
+    VideoWriter rawVideo;
+    string recordPath, recordVideoPath, scenePath;
+    bool lowLatency = false;
+    bool overlayCacheEnabled = true;
+    bool cullingEnabled = true;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--publish") {
+            string name = (i + 1 < argc && argv[i + 1][0] == '/') ? argv[++i] : "/ar_pose";
+            if (poseWriter.open(name))
+                cout << "Publishing poses to shared memory " << name << endl;
+        }
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--record-video" && i + 1 < argc)
+            recordVideoPath = argv[++i];
+        else if (arg == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (arg == "--low-latency")
+            lowLatency = true;
+        else if (arg == "--no-overlay-cache")
+            overlayCacheEnabled = false;
+        else if (arg == "--no-cull")
+            cullingEnabled = false;
+    }
+
+    // Load the scene. Without --scene this is the car model adjusted so it
+    // appears above the target (scale 1.0, raised 5.0 units in z).
+    Scene scene;
+    bool sceneLoaded = scenePath.empty() ? makeSingleModelScene("../models/newcar.obj", 1.0f, 5.0f, scene)
+                                         : loadScene(scenePath, scene);
+    if (!sceneLoaded)
         return -1;
-    
-    // Adjust the model so it appears above the target.
-    adjustModel(objVertices, 1.0f, 5.0f);
-    
-    VideoCapture cap(0);
-    if (!cap.isOpened()){
-        cerr << "Error: Could not open the camera." << endl;
+    // Skips the parts of the scene outside the image (see mesh_bvh.hpp).
+    SceneProjector sceneProjector;
+    sceneProjector.setCulling(cullingEnabled);
+
+    // Reuses the drawn overlay while the pose stays put (see overlay_cache.hpp).
+    OverlayCache overlayCache;
+    overlayCache.setEnabled(overlayCacheEnabled);
+
+    // Sends one frame's result to every enabled output.
+    int64_t captureNs = 0;
+    uint32_t frameIndex = 0;
+    auto reportPose = [&](int16_t state, const Mat& rvec, const Mat& tvec, const vector<Point2f>& points) {
+        publishPose(poseWriter, captureNs, state, rvec, tvec, points);
+        logFrame(trajectoryLog, captureNs, frameIndex, state, rvec, tvec, points);
+    };
+    long framesRead = 0;
+
+    // Open the default camera. With --low-latency a capture thread keeps only
+    // the newest frame (see latest_frame.hpp).
+    CameraSource camera;
+    if (!camera.open(0, lowLatency))
         return -1;
-    }
+    LatencyMeter latency;
     const string windowName = "AR Model with Detection & Tracking";
     
     // State variables for tracking.
     bool isTracking = false;
+    bool justDetected = false; // first frame after a detection
     vector<Point2f> targetCorners; // current corners (ordered)
     Mat prevFrame;  // previous frame for optical flow
     
     while (true) {
         Mat frame;
-        cap >> frame;
-        if (frame.empty()) {
+        FrameStamp stamp;
+        if (!camera.read(frame, stamp)) {
             cerr << "Error: Captured empty frame." << endl;
             break;
         }
+        captureNs = stamp.captureNs;
+        frameIndex = (uint32_t)framesRead++;
+
+        // Recorders are opened on the first frame, once the frame size is known.
+        if (frameIndex == 0) {
+            if (!recordPath.empty() &&
+                openTrajectoryLog(trajectoryLog, recordPath, frame.size(), cameraMatrix, distCoeffs, captureNs))
+                cout << "Recording trajectory log to " << recordPath << endl;
+            if (!recordVideoPath.empty() &&
+                !rawVideo.open(recordVideoPath, VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, frame.size()))
+                cerr << "Error: Could not open " << recordVideoPath << " for writing." << endl;
+        }
+        if (rawVideo.isOpened())
+            rawVideo.write(frame);
         
         // If not tracking, try to detect the target.
+        justDetected = false;
         if (!isTracking) {
             if (detectTarget(frame, targetCorners)) {
                 isTracking = true;
+                justDetected = true;
                 // Copy current frame for tracking reference.
                 prevFrame = frame.clone();
                 cout << "Target detected and locked." << endl;
@@ -260,47 +265,50 @@ int main() {
             
             // Estimate pose using solvePnP.
             Mat rvec, tvec;
+            bool reported = false;
             try {
                 bool success = solvePnP(targetObjectPoints, targetCorners, cameraMatrix, distCoeffs, rvec, tvec);
+                if (success)
+                    reportPose(justDetected ? POSE_DETECTED : POSE_TRACKED, rvec, tvec, targetCorners);
+                else
+                    reportPose(POSE_LOST, Mat(), Mat(), targetCorners);
+                reported = true;
                 if (success) {
-                    drawFrameAxes(frame, cameraMatrix, distCoeffs, rvec, tvec, 3);
-                    
-                    // Project and render the OBJ model.
-                    vector<Point2f> projectedPoints;
-                    projectPoints(objVertices, rvec, tvec, cameraMatrix, distCoeffs, projectedPoints);
-                    if (projectedPoints.size() == objVertices.size()) {
-                        for (size_t i = 0; i < objFaces.size(); i++) {
-                            int i1 = objFaces[i][0];
-                            int i2 = objFaces[i][1];
-                            int i3 = objFaces[i][2];
-                            if(i1 < 0 || i1 >= projectedPoints.size() ||
-                               i2 < 0 || i2 >= projectedPoints.size() ||
-                               i3 < 0 || i3 >= projectedPoints.size())
-                                continue;
-                            line(frame, projectedPoints[i1], projectedPoints[i2], Scalar(255, 255, 255), 2);
-                            line(frame, projectedPoints[i2], projectedPoints[i3], Scalar(255, 255, 255), 2);
-                            line(frame, projectedPoints[i3], projectedPoints[i1], Scalar(255, 255, 255), 2);
-                        }
-                    } else {
-                        cerr << "Mismatch in projected points and model vertices." << endl;
-                    }
+                    overlayCache.render(frame, rvec, tvec, [&](Mat& target) {
+                        Rect drawn = drawAxes(target, cameraMatrix, distCoeffs, rvec, tvec, 3);
+
+                        // Project every model instance in one batch and render it.
+                        sceneProjector.project(scene, rvec, tvec, cameraMatrix, distCoeffs, target.size());
+                        return drawn | sceneProjector.draw(target, scene, Scalar(255, 255, 255), 2);
+                    });
                 } else {
                     cout << "Pose estimation failed." << endl;
                 }
             } catch (const Exception &e) {
                 cerr << "Exception in solvePnP: " << e.what() << endl;
+                // Every frame gets exactly one record, even when solvePnP throws.
+                if (!reported)
+                    reportPose(POSE_LOST, Mat(), Mat(), targetCorners);
             }
         } else {
+            reportPose(POSE_LOST, Mat(), Mat(), vector<Point2f>());
             putText(frame, "Target not detected", Point(50, 50), FONT_HERSHEY_SIMPLEX, 1, Scalar(0,0,255), 2);
         }
         
         imshow(windowName, frame);
+        latency.displayed(stamp, camera.dropped());
         char key = (char)waitKey(10);
         if (key == 27) // ESC to exit
             break;
     }
     
-    cap.release();
+    trajectoryLog.close();
+    rawVideo.release();
+    latency.report();
+    if (overlayCache.enabled())
+        cout << "Overlay cache: reused " << overlayCache.hits() << " of "
+             << overlayCache.hits() + overlayCache.misses() << " overlays." << endl;
+    camera.release();
     destroyAllWindows();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Low-latency camera capture: a dedicated thread drains the camera and keeps
+// only the newest frame, so a slow detection/render loop always works on a
+// fresh image instead of the oldest one queued in the driver.
+//
+// The handoff is a triple buffer. The capture thread fills its back slot and
+// swaps it with the shared middle slot in one atomic exchange; the consumer
+// swaps its front slot with the middle slot when it holds a fresh frame. A
+// frame replaced before the consumer picked it up is counted as dropped.
+// Frames are never copied.
+//
+// Timestamps are on std::chrono::steady_clock (CLOCK_MONOTONIC on Linux, the
+// same clock as poseShmNowNs). V4L2 reports the time the driver filled the
+// buffer through CAP_PROP_POS_MSEC, on that same clock, and that is used when
+// available. Time spent waiting in the driver queue is then part of the
+// measured latency. Other backends report a stream position instead, so the
+// time read() returned is used, which leaves the queue wait out.
+// LatencyMeter says which kind of stamp it measured.
+//
+// Both modes leave the driver queue at its default depth, so the comparison
+// isolates the capture thread. The grabber drains the queue continuously, so
+// its frames never wait there long.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct FrameStamp {
+    uint64_t seq = 0;       // capture sequence number, gaps are dropped frames
+    int64_t captureNs = 0;  // steady_clock time of capture
+    bool driverTime = false; // captureNs is the driver's buffer time, not read time
+};
+
+inline int64_t frameClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Stamps the frame 'cap' just returned. The buffer time is only trusted if
+// it lies on the steady clock: not after the read and at most 2 s before it.
+inline void stampFrame(cv::VideoCapture& cap, FrameStamp& stamp) {
+    const int64_t readNs = frameClockNs();
+    const int64_t bufferNs = (int64_t)(cap.get(cv::CAP_PROP_POS_MSEC) * 1e6);
+    stamp.driverTime = bufferNs > 0 && bufferNs <= readNs && readNs - bufferNs < 2000000000LL;
+    stamp.captureNs = stamp.driverTime ? bufferNs : readNs;
+}
+
+// -----------------------------------------------------------------------------
+class LatestFrameGrabber {
+public:
+    LatestFrameGrabber() = default;
+    LatestFrameGrabber(const LatestFrameGrabber&) = delete;
+    LatestFrameGrabber& operator=(const LatestFrameGrabber&) = delete;
+    ~LatestFrameGrabber() { stop(); }
+
+    // Opens the camera and starts the capture thread.
+    bool open(int device) {
+        stop();
+        if (!cap_.open(device))
+            return false;
+        middle_.store(1, std::memory_order_relaxed);
+        front_ = 0;
+        back_ = 2;
+        stop_ = false;
+        eof_ = false;
+        captured_ = 0;
+        dropped_ = 0;
+        thread_ = std::thread([this] { captureLoop(); });
+        return true;
+    }
+
+    // Newest frame not returned before. Waits as long as the capture thread
+    // runs, so a camera that is slow to start does not end the caller's
+    // loop. Returns false only once the capture thread has stopped (end of
+    // stream or read error) and no fresh frame is left. 'frame' shares the
+    // slot's buffer; the capture thread allocates a new one rather than
+    // overwrite a buffer the caller still holds.
+    bool read(cv::Mat& frame, FrameStamp& stamp) {
+        if (!(middle_.load(std::memory_order_acquire) & kFresh)) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] {
+                return (middle_.load(std::memory_order_acquire) & kFresh) || eof_.load();
+            });
+            if (!(middle_.load(std::memory_order_acquire) & kFresh))
+                return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        frame = slots_[front_].frame;
+        stamp = slots_[front_].stamp;
+        return true;
+    }
+
+    void stop() {
+        if (thread_.joinable()) {
+            stop_ = true;
+            thread_.join();
+        }
+        cap_.release();
+    }
+
+    uint64_t captured() const { return captured_.load(); }
+    uint64_t dropped() const { return dropped_.load(); }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;
+
+    struct Slot {
+        cv::Mat frame;
+        FrameStamp stamp;
+    };
+
+    void captureLoop() {
+        uint64_t seq = 0;
+        while (!stop_) {
+            Slot &slot = slots_[back_];
+            // The consumer may still hold this buffer from an earlier read()
+            // and changes the count from its thread, so read it atomically.
+            if (slot.frame.u && CV_XADD(&slot.frame.u->refcount, 0) > 1)
+                slot.frame.release();
+            if (!cap_.read(slot.frame) || slot.frame.empty())
+                break;
+            stampFrame(cap_, slot.stamp);
+            slot.stamp.seq = seq++;
+            captured_++;
+
+            const int previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+            back_ = previous & kIndexMask;
+            if (previous & kFresh)
+                dropped_++;
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            cv_.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            eof_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    cv::VideoCapture cap_;
+    Slot slots_[3];
+    std::atomic<int> middle_{1};  // slot index | kFresh
+    int front_ = 0;               // owned by the consumer
+    int back_ = 2;                // owned by the capture thread
+    std::atomic<bool> stop_{false}, eof_{false};
+    std::atomic<uint64_t> captured_{0}, dropped_{0};
+    std::mutex mutex_;            // only for sleeping while no frame is ready
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+// -----------------------------------------------------------------------------
+// Camera for the demos: reads inline like 'cap >> frame', or through a
+// LatestFrameGrabber in low-latency mode. Both paths stamp frames the same
+// way so their latencies can be compared.
+class CameraSource {
+public:
+    bool open(int device, bool lowLatency) {
+        lowLatency_ = lowLatency;
+        bool opened = lowLatency_ ? grabber_.open(device) : cap_.open(device);
+        if (!opened)
+            std::cerr << "Error: Could not open the camera." << std::endl;
+        return opened;
+    }
+
+    bool read(cv::Mat& frame, FrameStamp& stamp) {
+        if (lowLatency_)
+            return grabber_.read(frame, stamp);
+        if (!cap_.read(frame) || frame.empty())
+            return false;
+        stampFrame(cap_, stamp);
+        stamp.seq = seq_++;
+        return true;
+    }
+
+    uint64_t dropped() const { return lowLatency_ ? grabber_.dropped() : 0; }
+    bool lowLatency() const { return lowLatency_; }
+
+    void release() {
+        grabber_.stop();
+        cap_.release();
+    }
+
+private:
+    bool lowLatency_ = false;
+    cv::VideoCapture cap_;
+    LatestFrameGrabber grabber_;
+    uint64_t seq_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Capture-to-display latency, printed every 'reportEvery' frames.
+class LatencyMeter {
+public:
+    explicit LatencyMeter(int reportEvery = 300) : reportEvery_(reportEvery) {}
+
+    // Call right after the frame stamped 'stamp' was handed to imshow.
+    void displayed(const FrameStamp& stamp, uint64_t droppedTotal) {
+        samplesMs_.push_back((frameClockNs() - stamp.captureNs) / 1e6);
+        driverStamps_ += stamp.driverTime ? 1 : 0;
+        dropped_ = droppedTotal;
+        if ((int)samplesMs_.size() >= reportEvery_)
+            report();
+    }
+
+    void report() {
+        if (samplesMs_.empty())
+            return;
+        std::vector<double> s = samplesMs_;
+        std::sort(s.begin(), s.end());
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1)
+             << "Capture->display latency over " << s.size() << " frames: p50 "
+             << s[s.size() / 2] << " ms, p95 " << s[s.size() * 95 / 100] << " ms, max "
+             << s.back() << " ms; " << dropped_ << " stale frames dropped";
+        if (driverStamps_ == s.size())
+            line << " (driver buffer timestamps)";
+        else
+            line << " (" << s.size() - driverStamps_ << " frames stamped at read time,"
+                 << " driver queue wait not included)";
+        std::cout << line.str() << std::endl;
+        samplesMs_.clear();
+        driverStamps_ = 0;
+    }
+
+private:
+    int reportEvery_;
+    uint64_t dropped_ = 0;
+    size_t driverStamps_ = 0;
+    std::vector<double> samplesMs_;
+};
@@ -9,14 +9,73 @@ Project 4 - Calibration and Augmented Reality
 */
 
 #include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
+#include "corner_refine.hpp"
+#include "quality_governor.hpp"
+#include "xcorner_detector.hpp"
+
 using namespace cv;
 using namespace std;
 
-int main()
+// Detects the 9x6 board on 'frame' downscaled by 'scale' and returns the
+// corners in full-resolution coordinates.
+static bool detectBoard(const Mat& frame, double scale, bool useXCorner, XCornerDetector<9, 6>& xcorner,
+                        const CornerRefineParams& refineParams, Size patternSize, vector<Point2f>& cornerSet)
+{
+    Mat smallFrame, smallGray;
+    resize(frame, smallFrame, Size(), scale, scale, INTER_LINEAR);
+    cvtColor(smallFrame, smallGray, COLOR_BGR2GRAY);
+
+    bool patternFound;
+    if (useXCorner) {
+        patternFound = xcorner.detect(smallGray, cornerSet); // already refined
+    }
+    else {
+        patternFound = findChessboardCorners(smallGray, patternSize, cornerSet,
+            CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
+        // Refine corner locations (window sized to the board, see corner_refine.hpp)
+        if (patternFound)
+            refineCorners(smallGray, cornerSet, patternSize, refineParams);
+    }
+    if (!patternFound)
+        return false;
+
+    // Scale detected corner coordinates back to full resolution
+    for (auto &pt : cornerSet) {
+        pt.x /= scale;
+        pt.y /= scale;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
 {
+    // Optional: "--target-fps <f>" lowers the detection scale and refinement
+    // iterations of the live preview when frames take longer than 1/f (see
+    // quality_governor.hpp). Saved calibration frames are always detected
+    // at full quality.
+    // "--xcorner" uses the 9x6 X-corner detector (see xcorner_detector.hpp).
+    // Its corners always start next to the dark corner square, while
+    // findChessboardCorners may start at either end of the board; the
+    // per-view extrinsics absorb that, so the intrinsics are the same.
+    double targetFps = 0;
+    bool useXCorner = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--target-fps" && i + 1 < argc)
+            targetFps = atof(argv[++i]);
+        else if (arg == "--xcorner")
+            useXCorner = true;
+    }
+    QualityGovernor governor = QualityGovernor::forTargetFps(targetFps);
+    CornerRefineParams refineParams;
+    XCornerDetector<9, 6> xcorner;
+    XCornerDetector<9, 6> xcornerFullQuality; // default refinement, for saved frames
+
     // Open the default camera
     VideoCapture cap(0);
     if (!cap.isOpened()) {
@@ -28,8 +87,10 @@ int main()
     Size patternSize(9, 6);
     const string windowName = "Checkerboard Calibration";
 
-    // Scale factor for processing (process a downscaled version for speed)
-    double scaleFactor = 0.5;
+    // Scale factor for processing (process a downscaled version for speed).
+    // The governor may lower it further.
+    const double baseScaleFactor = 0.5;
+    double scaleFactor = baseScaleFactor;
 
     int frameCount = 0;
     
@@ -41,6 +102,9 @@ int main()
     // Variables to store the last valid detection (image and corners)
     vector<Point2f> lastValidCorners;
     Mat lastValidImage;
+    // Undrawn copy of the last valid frame, kept only while the governor has
+    // lowered the quality: saving re-detects on it at full quality.
+    Mat lastValidRaw;
 
     // Variables for calibration results
     bool calibrated = false;
@@ -59,27 +123,18 @@ int main()
             cerr << "Error: Captured empty frame." << endl;
             break;
         }
+        auto frameStart = chrono::steady_clock::now();
 
-        // Downscale the full resolution frame for faster processing
-        Mat smallFrame, smallGray;
-        resize(fullFrame, smallFrame, Size(), scaleFactor, scaleFactor, INTER_LINEAR);
-        cvtColor(smallFrame, smallGray, COLOR_BGR2GRAY);
-
-        // Detect the checkerboard corners on the downscaled frame
+        // Detect the checkerboard corners on a downscaled copy for speed
         vector<Point2f> cornerSet;
-        bool patternFound = findChessboardCorners(smallGray, patternSize, cornerSet,
-            CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
+        bool patternFound = detectBoard(fullFrame, scaleFactor, useXCorner, xcorner, refineParams,
+                                        patternSize, cornerSet);
 
         if (patternFound) {
-            // Refine corner locations
-            cornerSubPix(smallGray, cornerSet, Size(11, 11), Size(-1, -1),
-                TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 30, 0.1));
-
-            // Scale detected corner coordinates back to full resolution
-            for (auto &pt : cornerSet) {
-                pt.x /= scaleFactor;
-                pt.y /= scaleFactor;
-            }
+            if (governor.level() > 0)
+                lastValidRaw = fullFrame.clone();
+            else
+                lastValidRaw.release();
 
             // Draw the detected corners on the full resolution frame
             drawChessboardCorners(fullFrame, patternSize, Mat(cornerSet), patternFound);
@@ -96,12 +151,31 @@ int main()
         // Show the full-resolution frame with drawn corners
         imshow(windowName, fullFrame);
 
+        if (governor.update(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count())) {
+            scaleFactor = baseScaleFactor * governor.settings().detectScale;
+            refineParams.maxIterations = governor.settings().refineIterations;
+            xcorner.setRefineParams(refineParams);
+            governor.print(cout);
+        }
+
         // Wait for key press (1ms delay)
         char key = (char)waitKey(1);
         if (key == 27) { // ESC key exits
             break;
         }
         else if (key == 's' || key == 'S') {
+            // Corners found at reduced quality are detected again at full
+            // quality, so the governor never degrades the calibration.
+            bool fullQualityFailed = false;
+            if (!lastValidRaw.empty()) {
+                if (!detectBoard(lastValidRaw, baseScaleFactor, useXCorner, xcornerFullQuality,
+                                 CornerRefineParams(), patternSize, lastValidCorners)) {
+                    cout << "Board not found at full quality; frame not saved." << endl;
+                    lastValidCorners.clear();
+                    fullQualityFailed = true;
+                }
+                lastValidRaw.release();
+            }
             // Save calibration data only if we have a valid detection
             if (!lastValidCorners.empty()) {
                 // Save the detected 2D corners
@@ -121,7 +195,7 @@ int main()
                 // Save the calibration image used for this detection
                 image_list.push_back(lastValidImage);
                 cout << "Calibration frame saved. Total frames: " << corner_list.size() << endl;
-            } else {
+            } else if (!fullQualityFailed) {
                 cout << "No valid detection available to save." << endl;
             }
         }
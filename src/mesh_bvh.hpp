@@ -0,0 +1,213 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Bounding-volume hierarchy over the triangles of one mesh, used by
+// SceneProjector (scene.hpp) to skip the parts of a model outside the image.
+//
+// The tree is built once at load time in mesh coordinates. Nodes are
+// axis-aligned boxes. Each node is split at the median triangle centroid
+// along the longest axis of the centroid bounds, down to leaves of at most
+// kLeafTriangles triangles. Each leaf also keeps the vertices its triangles
+// use, so a visible leaf can be projected without touching the rest of the
+// mesh.
+//
+// Every instance of a mesh shares its tree. The frustum planes are moved into
+// mesh space once per instance, so the boxes are never transformed.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Half-space n . x + d >= 0.
+struct CullPlane {
+    cv::Vec3d n;
+    double d;
+};
+
+class MeshBVH {
+public:
+    // Small enough that a close-up skips most of a large model, large enough
+    // that traversal and per-leaf bookkeeping stay cheap.
+    static constexpr int kLeafTriangles = 64;
+    static constexpr int kMaxPlanes = 8;
+
+    struct Node {
+        cv::Point3f lo, hi;                     // bounds of the node's triangles
+        int left = -1, right = -1;              // children, -1 for a leaf
+        int firstTriangle = 0, numTriangles = 0;
+        int firstVertex = 0, numVertices = 0;   // leaves only
+        bool leaf() const { return left < 0; }
+    };
+
+    // Faces with out-of-range indices are left out; they are never drawn.
+    void build(const std::vector<cv::Point3f>& vertices, const std::vector<cv::Vec3i>& faces) {
+        nodes_.clear();
+        triangles_.clear();
+        leafVertices_.clear();
+        const int n = (int)vertices.size();
+        centroids_.assign(faces.size(), cv::Point3f());
+        for (int k = 0; k < (int)faces.size(); k++) {
+            const cv::Vec3i &f = faces[k];
+            if (f[0] < 0 || f[0] >= n || f[1] < 0 || f[1] >= n || f[2] < 0 || f[2] >= n)
+                continue;
+            triangles_.push_back(k);
+            centroids_[k] = (vertices[f[0]] + vertices[f[1]] + vertices[f[2]]) * (1.0f / 3.0f);
+        }
+        if (!triangles_.empty()) {
+            nodes_.reserve(4 * triangles_.size() / kLeafTriangles + 1);
+            vertexStamp_.assign(n, -1);
+            buildNode(vertices, faces, 0, (int)triangles_.size());
+        }
+        std::vector<cv::Point3f>().swap(centroids_);
+        std::vector<int>().swap(vertexStamp_);
+    }
+
+    bool empty() const { return nodes_.empty(); }
+    const Node& node(int i) const { return nodes_[i]; }
+    size_t numNodes() const { return nodes_.size(); }
+    size_t numTriangles() const { return triangles_.size(); }
+
+    // Face indices in leaf order; Node::firstTriangle indexes into this.
+    const std::vector<int>& triangles() const { return triangles_; }
+    // Vertex indices of each leaf; Node::firstVertex indexes into this.
+    const std::vector<int>& leafVertices() const { return leafVertices_; }
+
+    // Appends every leaf whose box is not entirely outside one of the planes
+    // (at most kMaxPlanes) and returns how many triangles they hold. The test
+    // is conservative: a box near a frustum edge may be kept although none
+    // of its triangles is inside. A box entirely inside a plane drops that
+    // plane for its subtree; once no planes remain, the leaves are taken
+    // without further tests.
+    int cull(const CullPlane* planes, int numPlanes, std::vector<int>& leaves) const {
+        if (nodes_.empty())
+            return 0;
+        numPlanes = std::min(numPlanes, kMaxPlanes);
+        // Median splits halve the triangle count per level, so the depth and
+        // hence the stack stay under 32 entries for any int-sized mesh.
+        std::array<Entry, 64> stack;
+        int top = 0;
+        int visible = 0;
+        stack[top++] = Entry{0, (1u << numPlanes) - 1u};
+        while (top > 0) {
+            const Entry e = stack[--top];
+            const Node &nd = nodes_[e.node];
+            unsigned active = e.planes;
+            bool outside = false;
+            for (int p = 0; p < numPlanes && !outside; p++) {
+                if (!(active & (1u << p)))
+                    continue;
+                const int side = classify(nd, planes[p]);
+                if (side < 0)
+                    outside = true;
+                else if (side > 0)
+                    active &= ~(1u << p);
+            }
+            if (outside)
+                continue;
+            if (nd.leaf()) {
+                leaves.push_back(e.node);
+                visible += nd.numTriangles;
+            } else {
+                stack[top++] = Entry{nd.right, active};
+                stack[top++] = Entry{nd.left, active};
+            }
+        }
+        return visible;
+    }
+
+private:
+    struct Entry {
+        int node;
+        unsigned planes; // bit p set: plane p still has to be tested
+    };
+
+    // -1 if the box is entirely outside the plane, +1 if entirely inside,
+    // 0 if it straddles it.
+    static int classify(const Node& nd, const CullPlane& pl) {
+        const double cx = 0.5 * ((double)nd.lo.x + nd.hi.x), ex = 0.5 * ((double)nd.hi.x - nd.lo.x);
+        const double cy = 0.5 * ((double)nd.lo.y + nd.hi.y), ey = 0.5 * ((double)nd.hi.y - nd.lo.y);
+        const double cz = 0.5 * ((double)nd.lo.z + nd.hi.z), ez = 0.5 * ((double)nd.hi.z - nd.lo.z);
+        const double dist = pl.n[0] * cx + pl.n[1] * cy + pl.n[2] * cz + pl.d;
+        const double radius = std::abs(pl.n[0]) * ex + std::abs(pl.n[1]) * ey + std::abs(pl.n[2]) * ez;
+        if (dist + radius < 0)
+            return -1;
+        return dist - radius >= 0 ? 1 : 0;
+    }
+
+    // Builds the subtree over triangles_[first, first + count) and returns
+    // its node index.
+    int buildNode(const std::vector<cv::Point3f>& vertices, const std::vector<cv::Vec3i>& faces,
+                  int first, int count) {
+        const int index = (int)nodes_.size();
+        nodes_.emplace_back();
+        Node nd;
+        nd.firstTriangle = first;
+        nd.numTriangles = count;
+
+        const float inf = std::numeric_limits<float>::max();
+        nd.lo = cv::Point3f(inf, inf, inf);
+        nd.hi = cv::Point3f(-inf, -inf, -inf);
+        cv::Point3f clo = nd.lo, chi = nd.hi;
+        for (int t = first; t < first + count; t++) {
+            const cv::Vec3i &f = faces[triangles_[t]];
+            for (int j = 0; j < 3; j++)
+                grow(nd.lo, nd.hi, vertices[f[j]]);
+            grow(clo, chi, centroids_[triangles_[t]]);
+        }
+
+        const cv::Point3f extent = chi - clo;
+        const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        const float axisExtent = axis == 0 ? extent.x : (axis == 1 ? extent.y : extent.z);
+        if (count <= kLeafTriangles || axisExtent <= 0.0f) {
+            // Leaf: collect the distinct vertices of its triangles.
+            nd.firstVertex = (int)leafVertices_.size();
+            for (int t = first; t < first + count; t++) {
+                const cv::Vec3i &f = faces[triangles_[t]];
+                for (int j = 0; j < 3; j++) {
+                    if (vertexStamp_[f[j]] != index) {
+                        vertexStamp_[f[j]] = index;
+                        leafVertices_.push_back(f[j]);
+                    }
+                }
+            }
+            nd.numVertices = (int)leafVertices_.size() - nd.firstVertex;
+            nodes_[index] = nd;
+            return index;
+        }
+
+        const int mid = first + count / 2;
+        std::nth_element(triangles_.begin() + first, triangles_.begin() + mid, triangles_.begin() + first + count,
+                         [&](int a, int b) { return coord(centroids_[a], axis) < coord(centroids_[b], axis); });
+        nd.left = buildNode(vertices, faces, first, mid - first);
+        nd.right = buildNode(vertices, faces, mid, first + count - mid);
+        nodes_[index] = nd; // nodes_ may have been reallocated by the children
+        return index;
+    }
+
+    static void grow(cv::Point3f& lo, cv::Point3f& hi, const cv::Point3f& p) {
+        lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y); lo.z = std::min(lo.z, p.z);
+        hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y); hi.z = std::max(hi.z, p.z);
+    }
+
+    static float coord(const cv::Point3f& p, int axis) { return axis == 0 ? p.x : (axis == 1 ? p.y : p.z); }
+
+    std::vector<Node> nodes_;
+    std::vector<int> triangles_;
+    std::vector<int> leafVertices_;
+
+    // Build-time scratch.
+    std::vector<cv::Point3f> centroids_;
+    std::vector<int> vertexStamp_;
+};
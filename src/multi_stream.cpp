@@ -0,0 +1,361 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Multi-stream AR engine: runs N independent inputs (cameras or video files)
+// on one shared work-stealing pool. Each stream has its own BoardTracker;
+// the OBJ model and the calibration files are loaded once and shared.
+//
+// Usage:
+//   multistream [options] <source> [<source> ...]
+//     source            camera index ("0") or video file, optionally followed
+//                       by "@<intrinsics.yaml>" for a per-camera calibration
+//     --intrinsics <f>  default calibration (../calibration/intrinsics.yaml)
+//     --model <f>       OBJ model (../models/newcar.obj)
+//     --threads <n>     pool size (default: all hardware threads)
+//     --frames <n>      stop every stream after n frames
+//     --show            display the annotated streams
+//     --target-fps <f>  per-stream quality governor holding f FPS (see quality_governor.hpp)
+//   multistream --bench <video> [--max-streams <n>] [--frames <n>]
+//     Runs 1..n copies of the video on 1..all cores and prints aggregate FPS
+//     and fairness (slowest / fastest per-stream FPS). Exits with an error
+//     if a stream misses frames or the fairness drops below 0.5.
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ar_common.hpp"
+#include "board_tracker.hpp"
+#include "quality_governor.hpp"
+#include "work_stealing_pool.hpp"
+
+using namespace cv;
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Loads every calibration file once, no matter how many streams use it.
+class IntrinsicsCache {
+public:
+    shared_ptr<const CameraIntrinsics> get(const string& path) {
+        auto it = cache_.find(path);
+        if (it != cache_.end())
+            return it->second;
+        auto intr = make_shared<CameraIntrinsics>();
+        if (!loadIntrinsics(path, intr->cameraMatrix, intr->distCoeffs))
+            return nullptr;
+        cout << "Loaded intrinsics: " << path << endl;
+        cache_[path] = intr;
+        return intr;
+    }
+
+private:
+    map<string, shared_ptr<const CameraIntrinsics>> cache_;
+};
+
+// -----------------------------------------------------------------------------
+// One input stream. Only one task per stream is ever queued, so the tracker
+// and the capture are touched by a single thread at a time.
+struct Stream {
+    int id = 0;
+    string source;
+    VideoCapture cap;
+    unique_ptr<BoardTracker> tracker;
+    QualityGovernor governor; // disabled unless --target-fps
+    bool loop = false;       // rewind video files at the end (benchmark)
+    long maxFrames = 0;      // 0 = until the input ends
+    long frames = 0;
+    long posesFound = 0;
+    double finishSeconds = 0; // since runStreams started, set when the stream ends
+
+    // Latest annotated frame for the display thread.
+    mutex displayMutex;
+    Mat displayFrame;
+    bool displayDirty = false;
+};
+
+struct Engine {
+    WorkStealingPool* pool = nullptr;
+    bool draw = false;
+    atomic<bool> stop{false};
+    atomic<int> activeStreams{0};
+    chrono::steady_clock::time_point start;
+};
+
+static bool openSource(VideoCapture& cap, const string& source) {
+    bool isIndex = !source.empty() && source.find_first_not_of("0123456789") == string::npos;
+    return isIndex ? cap.open(stoi(source)) : cap.open(source);
+}
+
+// Processes a single frame of a stream and re-queues the stream.
+static void runStream(Engine* engine, Stream* s) {
+    Mat frame;
+    bool ok = !engine->stop && (s->maxFrames <= 0 || s->frames < s->maxFrames) && s->cap.read(frame);
+    if (!ok && s->loop && !engine->stop && (s->maxFrames <= 0 || s->frames < s->maxFrames)) {
+        s->cap.set(CAP_PROP_POS_FRAMES, 0);
+        ok = s->cap.read(frame);
+    }
+    if (!ok || frame.empty()) {
+        s->finishSeconds = chrono::duration<double>(chrono::steady_clock::now() - engine->start).count();
+        engine->activeStreams--;
+        return;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    FrameResult result;
+    try {
+        result = s->tracker->process(frame, engine->draw);
+    } catch (const Exception& e) {
+        // An exception must not leave the pool worker; end this stream only.
+        cerr << "Stream " << s->id << ": " << e.what() << "; stopping the stream." << endl;
+        s->finishSeconds = chrono::duration<double>(chrono::steady_clock::now() - engine->start).count();
+        engine->activeStreams--;
+        return;
+    }
+    double frameMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    if (s->governor.update(frameMs)) {
+        s->tracker->applyQuality(s->governor.settings());
+        cout << "Stream " << s->id << ": ";
+        s->governor.print(cout);
+    }
+    s->frames++;
+    if (result.poseValid)
+        s->posesFound++;
+
+    if (engine->draw) {
+        lock_guard<mutex> lock(s->displayMutex);
+        s->displayFrame = frame;
+        s->displayDirty = true;
+    }
+    // Behind the other streams queued on this worker, so every stream gets
+    // its turn (see WorkStealingPool::requeue).
+    engine->pool->requeue([engine, s] { runStream(engine, s); });
+}
+
+// Slowest over fastest per-stream frame rate, each stream measured up to its
+// own end. Near 1 when the pool serves the streams evenly.
+static double streamFairness(const vector<unique_ptr<Stream>>& streams) {
+    double lo = 0, hi = 0;
+    for (const auto &s : streams) {
+        const double fps = s->frames / max(s->finishSeconds, 1e-9);
+        lo = (lo == 0) ? fps : min(lo, fps);
+        hi = max(hi, fps);
+    }
+    return hi > 0 ? lo / hi : 1.0;
+}
+
+// Starts every stream on the pool and waits for all of them to finish.
+// Returns the wall time in seconds.
+static double runStreams(WorkStealingPool& pool, vector<unique_ptr<Stream>>& streams, bool show) {
+    Engine engine;
+    engine.pool = &pool;
+    engine.draw = show;
+    engine.activeStreams = (int)streams.size();
+    engine.start = chrono::steady_clock::now();
+    const auto start = engine.start;
+    for (auto &s : streams) {
+        Stream* sp = s.get();
+        pool.submit([&engine, sp] { runStream(&engine, sp); });
+    }
+
+    if (show) {
+        // HighGUI must stay on the main thread.
+        while (engine.activeStreams > 0) {
+            for (auto &s : streams) {
+                Mat toShow;
+                {
+                    lock_guard<mutex> lock(s->displayMutex);
+                    if (s->displayDirty) {
+                        toShow = s->displayFrame;
+                        s->displayDirty = false;
+                    }
+                }
+                if (!toShow.empty())
+                    imshow("Stream " + to_string(s->id) + ": " + s->source, toShow);
+            }
+            char key = (char)waitKey(10);
+            if (key == 27) // ESC to stop all streams
+                engine.stop = true;
+        }
+    }
+    pool.waitIdle();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------
+// Aggregate FPS for every (streams, threads) combination on one video.
+static int runBenchmark(const string& video, int maxStreams, long framesPerStream,
+                        shared_ptr<const CameraIntrinsics> intrinsics, shared_ptr<const MeshAsset> mesh) {
+    vector<unsigned> threadCounts;
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    for (unsigned t = 1; t < cores; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+
+    cout << "Benchmark: " << video << ", " << framesPerStream << " frames per stream, "
+         << cores << " hardware threads" << endl;
+    cout << setw(8) << "streams" << setw(9) << "threads" << setw(12) << "agg FPS"
+         << setw(14) << "FPS/stream" << setw(10) << "speedup" << setw(9) << "steals"
+         << setw(10) << "fairness" << endl;
+    bool even = true;
+
+    for (int numStreams = 1; numStreams <= maxStreams; numStreams *= 2) {
+        double baseFps = 0;
+        for (unsigned threads : threadCounts) {
+            vector<unique_ptr<Stream>> streams;
+            for (int i = 0; i < numStreams; i++) {
+                auto s = make_unique<Stream>();
+                s->id = i;
+                s->source = video;
+                if (!openSource(s->cap, video)) {
+                    cerr << "Error: Could not open " << video << endl;
+                    return -1;
+                }
+                s->tracker = make_unique<BoardTracker>(intrinsics, mesh);
+                s->loop = true;
+                s->maxFrames = framesPerStream;
+                streams.push_back(move(s));
+            }
+
+            WorkStealingPool pool(threads);
+            double seconds = runStreams(pool, streams, false);
+            long total = 0;
+            for (auto &s : streams) {
+                total += s->frames;
+                if (s->frames != framesPerStream) {
+                    cerr << "Error: stream " << s->id << " processed " << s->frames << " of "
+                         << framesPerStream << " frames." << endl;
+                    even = false;
+                }
+            }
+            double fps = total / seconds;
+            if (baseFps == 0)
+                baseFps = fps;
+            const double fairness = streamFairness(streams);
+            if (fairness < 0.5)
+                even = false;
+            cout << setw(8) << numStreams << setw(9) << threads << setw(12) << fixed << setprecision(1) << fps
+                 << setw(14) << fps / numStreams << setw(10) << setprecision(2) << fps / baseFps
+                 << setw(9) << pool.steals() << setw(10) << fairness << endl;
+        }
+    }
+    if (!even) {
+        cerr << "Error: the streams were not served evenly (fairness below 0.5 or missing frames)." << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    string defaultIntrinsics = "../calibration/intrinsics.yaml";
+    string modelPath = "../models/newcar.obj";
+    string benchVideo;
+    unsigned numThreads = thread::hardware_concurrency();
+    long maxFrames = 0;
+    int maxStreams = 8;
+    bool show = false;
+    double targetFps = 0;
+    vector<string> sources;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--intrinsics" && hasValue) defaultIntrinsics = argv[++i];
+        else if (arg == "--model" && hasValue) modelPath = argv[++i];
+        else if (arg == "--threads" && hasValue) numThreads = (unsigned)atoi(argv[++i]);
+        else if (arg == "--frames" && hasValue) maxFrames = atol(argv[++i]);
+        else if (arg == "--bench" && hasValue) benchVideo = argv[++i];
+        else if (arg == "--max-streams" && hasValue) maxStreams = atoi(argv[++i]);
+        else if (arg == "--show") show = true;
+        else if (arg == "--target-fps" && hasValue) targetFps = atof(argv[++i]);
+        else if (!arg.empty() && arg[0] != '-') sources.push_back(arg);
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return -1;
+        }
+    }
+    if (sources.empty() && benchVideo.empty()) {
+        cerr << "Usage: multistream [--threads n] [--frames n] [--show] [--target-fps f] <source>[@intrinsics.yaml] ..." << endl
+             << "       multistream --bench <video> [--max-streams n] [--frames n]" << endl;
+        return -1;
+    }
+
+    // Parallelism comes from running streams side by side; keep OpenCV's own
+    // thread pool out of the way so the two don't oversubscribe the cores.
+    setNumThreads(1);
+
+    // Shared read-only assets.
+    IntrinsicsCache intrinsicsCache;
+    auto mesh = make_shared<MeshAsset>();
+    if (!loadOBJ(modelPath, mesh->vertices, mesh->faces))
+        return -1;
+    adjustModel(mesh->vertices, 1.0f, 5.0f);
+    shared_ptr<const MeshAsset> sharedMesh = mesh;
+
+    if (!benchVideo.empty()) {
+        auto intrinsics = intrinsicsCache.get(defaultIntrinsics);
+        if (!intrinsics)
+            return -1;
+        return runBenchmark(benchVideo, maxStreams, maxFrames > 0 ? maxFrames : 300, intrinsics, sharedMesh);
+    }
+
+    vector<unique_ptr<Stream>> streams;
+    for (size_t i = 0; i < sources.size(); i++) {
+        string source = sources[i];
+        string intrinsicsPath = defaultIntrinsics;
+        size_t at = source.find('@');
+        if (at != string::npos) {
+            intrinsicsPath = source.substr(at + 1);
+            source = source.substr(0, at);
+        }
+        auto intrinsics = intrinsicsCache.get(intrinsicsPath);
+        if (!intrinsics)
+            return -1;
+
+        auto s = make_unique<Stream>();
+        s->id = (int)i;
+        s->source = source;
+        if (!openSource(s->cap, source)) {
+            cerr << "Error: Could not open source " << source << endl;
+            return -1;
+        }
+        s->tracker = make_unique<BoardTracker>(intrinsics, sharedMesh);
+        s->governor = QualityGovernor::forTargetFps(targetFps);
+        s->maxFrames = maxFrames;
+        streams.push_back(move(s));
+    }
+
+    WorkStealingPool pool(numThreads);
+    cout << "Running " << streams.size() << " stream(s) on " << pool.size() << " thread(s)." << endl;
+    double seconds = runStreams(pool, streams, show);
+
+    long total = 0;
+    for (auto &s : streams) {
+        cout << "Stream " << s->id << " (" << s->source << "): " << s->frames << " frames, "
+             << s->posesFound << " poses, " << fixed << setprecision(1)
+             << s->frames / max(s->finishSeconds, 1e-9) << " FPS" << endl;
+        total += s->frames;
+    }
+    cout << "Aggregate: " << total << " frames in " << fixed << setprecision(2) << seconds << " s ("
+         << total / seconds << " FPS), " << pool.steals() << " steals, fairness "
+         << streamFairness(streams) << endl;
+
+    destroyAllWindows();
+    return 0;
+}
@@ -0,0 +1,444 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Offline processing of one long recorded video on all cores.
+//
+// The video is cut into segments that start on keyframes. Each segment runs
+// on its own thread with its own VideoCapture and BoardTracker, so decoding,
+// detection, tracking and drawing all scale with the core count. A worker
+// starts --overlap frames before its segment and processes them without
+// keeping the results. If the board is in view during the overlap, the
+// tracker has detected it and is following it with optical flow by the first
+// frame of the segment, as in a serial run. Without the overlap, every
+// segment would start with a full detection.
+//
+// Workers take segments in order, so the early segments finish first. The
+// main thread merges them back in order while later segments are still
+// running:
+//   --log  per-frame results as a trajectory log (replay reads it, with
+//          --video pointing at the same input)
+//   --out  annotated output. A name with one %d or %0Nd (frames/%06d.jpg)
+//          is an image sequence: workers write each frame straight to its
+//          file, nothing is merged. Any other name is an MJPG video: each
+//          worker writes a temporary file, which the main thread decodes,
+//          re-encodes into the output and deletes. That re-encode runs on
+//          one thread and caps the throughput (see README).
+//
+// Keyframes come from a demux-only scan of the packets (no decoding). If the
+// backend cannot do that, segments are cut at even frame counts. Segments
+// and warm-ups start on keyframes when they are known, where seeking needs
+// no decoding of earlier frames. Whether a seek lands exactly on the
+// requested frame depends on the backend and the file; FFmpeg does for
+// common formats. After seeking, each worker checks that the capture
+// reports the requested position and fails the segment otherwise.
+//
+// A segment that cannot be opened, positioned or read to its end is run
+// again once on a fresh capture. If it fails again, its frame range is
+// reported and the program exits with an error; nothing is skipped silently.
+//
+// Usage:
+//   offline <video> [--log out.artrj] [--out annotated.avi | frames_%06d.jpg]
+//           [--threads n] [--segments n] [--overlap n] [--intrinsics f]
+//           [--model obj] [--serial]
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ar_common.hpp"
+#include "board_tracker.hpp"
+#include "trajectory_log.hpp"
+
+using namespace cv;
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Frame count and keyframe indices from the packets. Returns false if the
+// backend cannot read raw packets; 'frameCount' is then the container's
+// estimate.
+static bool scanKeyframes(const string& path, long& frameCount, vector<long>& keyframes) {
+    keyframes.clear();
+    frameCount = 0;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+    VideoCapture raw(path, CAP_FFMPEG, vector<int>{CAP_PROP_FORMAT, -1});
+    if (raw.isOpened() && raw.get(CAP_PROP_FORMAT) == -1) {
+        while (raw.grab()) {
+            if (raw.get(CAP_PROP_LRF_HAS_KEY_FRAME) != 0)
+                keyframes.push_back(frameCount);
+            frameCount++;
+        }
+        if (frameCount > 0 && !keyframes.empty())
+            return true;
+    }
+    keyframes.clear();
+#endif
+    VideoCapture cap(path);
+    frameCount = cap.isOpened() ? (long)cap.get(CAP_PROP_FRAME_COUNT) : 0;
+    return false;
+}
+
+struct Segment {
+    long begin = 0, end = 0;         // [begin, end) in source frames
+    vector<FrameResult> results;     // one per frame from begin on
+    vector<double> timestampsMs;     // source timestamp of each result
+    string tempVideo;                // annotated frames, merged then deleted
+    string error;                    // why the last attempt failed, empty if it did not
+    bool done = false;
+};
+
+// Cuts [0, frameCount) into about 'count' segments. Each cut moves forward
+// to the next keyframe when keyframes are known. The last segment runs to
+// the end of the file, so an underestimated frame count loses nothing.
+static vector<unique_ptr<Segment>> planSegments(long frameCount, const vector<long>& keyframes, int count) {
+    vector<long> cuts = {0};
+    for (int i = 1; i < count; i++) {
+        long cut = frameCount * i / count;
+        if (!keyframes.empty()) {
+            auto it = lower_bound(keyframes.begin(), keyframes.end(), cut);
+            if (it == keyframes.end())
+                break;
+            cut = *it;
+        }
+        if (cut > cuts.back())
+            cuts.push_back(cut);
+    }
+    vector<unique_ptr<Segment>> segments;
+    for (size_t i = 0; i < cuts.size(); i++) {
+        auto s = make_unique<Segment>();
+        s->begin = cuts[i];
+        s->end = i + 1 < cuts.size() ? cuts[i + 1] : numeric_limits<long>::max();
+        segments.push_back(move(s));
+    }
+    return segments;
+}
+
+// -----------------------------------------------------------------------------
+// Image sequence name such as "frames/%06d.jpg": the text around one integer
+// conversion, which may only carry a zero-padded width. The pattern is never
+// handed to printf.
+struct SequencePattern {
+    string prefix, suffix;
+    int width = 0;
+
+    bool parse(const string& pattern) {
+        const size_t at = pattern.find('%');
+        if (at == string::npos)
+            return false;
+        size_t i = at + 1;
+        while (i < pattern.size() && isdigit((unsigned char)pattern[i]))
+            i++;
+        if (i >= pattern.size() || pattern[i] != 'd' || pattern.find('%', i) != string::npos)
+            return false;
+        const string digits = pattern.substr(at + 1, i - at - 1);
+        if (!digits.empty() && (digits[0] != '0' || digits.size() > 2))
+            return false; // only %d and %0Nd
+        width = digits.empty() ? 0 : atoi(digits.c_str());
+        prefix = pattern.substr(0, at);
+        suffix = pattern.substr(i + 1);
+        return true;
+    }
+
+    string fileName(long frame) const {
+        string number = to_string(frame);
+        if ((int)number.size() < width)
+            number.insert(0, width - number.size(), '0');
+        return prefix + number + suffix;
+    }
+};
+
+struct Job {
+    string videoPath, outPath;
+    bool imageSequence = false;      // outPath is a sequence pattern
+    SequencePattern sequence;
+    vector<long> keyframes;          // empty if the scan was not possible
+    shared_ptr<const CameraIntrinsics> intrinsics;
+    shared_ptr<const MeshAsset> mesh;
+    long overlap = 30;
+    double fps = 30.0;
+    vector<unique_ptr<Segment>> segments;
+    atomic<size_t> next{0};
+    mutex doneMutex;
+    condition_variable segmentDone;
+};
+
+// Processes one segment from a cold start: warm-up frames first, then the
+// segment itself. Returns false, with the reason in s.error, if the video
+// cannot be opened or positioned, or stops before the end of a segment that
+// is not the last one.
+static bool processSegment(Job& job, size_t index) {
+    Segment& s = *job.segments[index];
+    s.results.clear();
+    s.timestampsMs.clear();
+    s.error.clear();
+    if (!s.tempVideo.empty()) {
+        std::remove(s.tempVideo.c_str()); // frames of a failed attempt
+        s.tempVideo.clear();
+    }
+
+    // The warm-up starts on the last keyframe at least 'overlap' frames
+    // before the segment, so the seek lands where decoding can begin.
+    long start = max(0L, s.begin - job.overlap);
+    if (!job.keyframes.empty()) {
+        auto it = upper_bound(job.keyframes.begin(), job.keyframes.end(), start);
+        start = it == job.keyframes.begin() ? 0 : *(it - 1);
+    }
+    VideoCapture cap(job.videoPath);
+    if (!cap.isOpened()) {
+        s.error = "could not open the video";
+        return false;
+    }
+    if (start > 0 && (!cap.set(CAP_PROP_POS_FRAMES, (double)start) ||
+                      (long)cap.get(CAP_PROP_POS_FRAMES) != start)) {
+        s.error = "could not seek to frame " + to_string(start);
+        return false;
+    }
+    BoardTracker tracker(job.intrinsics, job.mesh);
+    VideoWriter annotated;
+    const bool draw = !job.outPath.empty();
+    const bool last = index + 1 == job.segments.size();
+
+    Mat frame;
+    for (long f = start; f < s.end; f++) {
+        if (!cap.read(frame) || frame.empty()) {
+            if (last && f >= s.begin)
+                break; // end of the video
+            s.error = "read failed at frame " + to_string(f);
+            return false;
+        }
+        const bool keep = f >= s.begin;
+        FrameResult result = tracker.process(frame, draw && keep);
+        if (!keep)
+            continue;
+        s.results.push_back(std::move(result));
+        s.timestampsMs.push_back(cap.get(CAP_PROP_POS_MSEC));
+        if (!draw)
+            continue;
+        if (job.imageSequence) {
+            const string file = job.sequence.fileName(f);
+            if (!imwrite(file, frame)) {
+                s.error = "could not write " + file;
+                return false;
+            }
+            continue;
+        }
+        if (!annotated.isOpened()) {
+            s.tempVideo = job.outPath + ".part" + to_string(index) + ".avi";
+            if (!annotated.open(s.tempVideo, VideoWriter::fourcc('M', 'J', 'P', 'G'), job.fps, frame.size())) {
+                s.error = "could not open " + s.tempVideo;
+                return false;
+            }
+        }
+        annotated.write(frame);
+    }
+    if (last)
+        s.end = s.begin + (long)s.results.size();
+    return true;
+}
+
+// processSegment with any exception turned into a failed segment, so one
+// bad segment is reported by main instead of ending the process.
+static bool processSegmentSafely(Job& job, size_t index) {
+    Segment& s = *job.segments[index];
+    try {
+        return processSegment(job, index);
+    } catch (const std::exception& e) {
+        s.error = string("exception: ") + e.what();
+    } catch (...) {
+        s.error = "unknown exception";
+    }
+    return false;
+}
+
+static void worker(Job* job) {
+    for (size_t i = job->next++; i < job->segments.size(); i = job->next++) {
+        Segment& s = *job->segments[i];
+        if (!processSegmentSafely(*job, i)) {
+            cerr << "Warning: segment at frame " << s.begin << ": " << s.error << "; retrying" << endl;
+            processSegmentSafely(*job, i);
+        }
+        lock_guard<mutex> lock(job->doneMutex);
+        job->segments[i]->done = true;
+        job->segmentDone.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Appends one finished segment to the outputs and frees its memory. The
+// video part is decoded and re-encoded; image sequences need no merge.
+static long mergeSegment(Segment& s, TrajectoryLogWriter& log, VideoWriter& out, const string& outPath,
+                         const Job& job, Size frameSize) {
+    for (size_t k = 0; k < s.results.size(); k++) {
+        const FrameResult& r = s.results[k];
+        Mat rvec = r.poseValid ? r.rvec : Mat(), tvec = r.poseValid ? r.tvec : Mat();
+        logFrame(log, (int64_t)(s.timestampsMs[k] * 1e6), (uint32_t)(s.begin + (long)k),
+                 r.poseValid ? (int16_t)r.state : (int16_t)TrackState::Lost, rvec, tvec, r.corners);
+    }
+    if (!s.tempVideo.empty()) {
+        VideoCapture part(s.tempVideo);
+        Mat frame;
+        while (part.read(frame)) {
+            if (!out.isOpened() &&
+                !out.open(outPath, VideoWriter::fourcc('M', 'J', 'P', 'G'), job.fps, frameSize))
+                cerr << "Error: Could not open output video " << outPath << endl;
+            out.write(frame);
+        }
+        part.release();
+        std::remove(s.tempVideo.c_str());
+    }
+    long merged = (long)s.results.size();
+    vector<FrameResult>().swap(s.results);
+    vector<double>().swap(s.timestampsMs);
+    return merged;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cerr << "Usage: offline <video> [--log out.artrj] [--out annotated.avi] [--threads n]"
+             << " [--segments n] [--overlap n] [--intrinsics f] [--model obj] [--serial]" << endl;
+        return -1;
+    }
+    string videoPath = argv[1];
+    string logPath, outPath;
+    string intrinsicsPath = "../calibration/intrinsics.yaml";
+    string modelPath = "../models/newcar.obj";
+    unsigned numThreads = max(1u, thread::hardware_concurrency());
+    int numSegments = 0;
+    long overlap = 30;
+    bool serial = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--log" && hasValue) logPath = argv[++i];
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--threads" && hasValue) numThreads = (unsigned)max(1, atoi(argv[++i]));
+        else if (arg == "--segments" && hasValue) numSegments = atoi(argv[++i]);
+        else if (arg == "--overlap" && hasValue) overlap = max(0L, atol(argv[++i]));
+        else if (arg == "--intrinsics" && hasValue) intrinsicsPath = argv[++i];
+        else if (arg == "--model" && hasValue) modelPath = argv[++i];
+        else if (arg == "--serial") serial = true;
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return -1;
+        }
+    }
+
+    auto intrinsics = make_shared<CameraIntrinsics>();
+    if (!loadIntrinsics(intrinsicsPath, intrinsics->cameraMatrix, intrinsics->distCoeffs))
+        return -1;
+    auto mesh = make_shared<MeshAsset>();
+    if (!loadOBJ(modelPath, mesh->vertices, mesh->faces))
+        return -1;
+    adjustModel(mesh->vertices, 1.0f, 5.0f);
+
+    const bool imageSequence = outPath.find('%') != string::npos;
+    SequencePattern sequence;
+    if (imageSequence && !sequence.parse(outPath)) {
+        cerr << "Error: --out " << outPath << " must contain exactly one %d or %0Nd (e.g. frames/%06d.jpg)." << endl;
+        return -1;
+    }
+    VideoCapture probe(videoPath);
+    if (!probe.isOpened()) {
+        cerr << "Error: Could not open " << videoPath << endl;
+        return -1;
+    }
+    Job job;
+    job.videoPath = videoPath;
+    job.outPath = outPath;
+    job.imageSequence = imageSequence;
+    job.sequence = sequence;
+    job.intrinsics = intrinsics;
+    job.mesh = mesh;
+    job.overlap = overlap;
+    job.fps = probe.get(CAP_PROP_FPS) > 0 ? probe.get(CAP_PROP_FPS) : 30.0;
+    Size frameSize((int)probe.get(CAP_PROP_FRAME_WIDTH), (int)probe.get(CAP_PROP_FRAME_HEIGHT));
+    probe.release();
+
+    // Several segments per thread so a slow segment near the end does not
+    // leave the other cores idle, but each segment at least ten warm-ups long.
+    long frameCount = 0;
+    vector<long> keyframes;
+    auto t0 = chrono::steady_clock::now();
+    bool haveKeyframes = scanKeyframes(videoPath, frameCount, keyframes);
+    if (serial) {
+        numThreads = 1;
+        numSegments = 1;
+    } else if (numSegments <= 0) {
+        long byLength = frameCount / max(300L, 10 * overlap);
+        numSegments = (int)max(1L, min<long>(4L * numThreads, byLength));
+    }
+    job.segments = planSegments(frameCount, keyframes, numSegments);
+    job.keyframes = keyframes;
+    cout << videoPath << ": " << frameCount << " frames, "
+         << (haveKeyframes ? to_string(keyframes.size()) + " keyframes" : string("no keyframe index")) << ", "
+         << job.segments.size() << " segment(s) on " << numThreads << " thread(s), overlap " << overlap << endl;
+
+    // Parallelism comes from the segments; keep OpenCV's own thread pool out
+    // of the way, as multistream does.
+    setNumThreads(1);
+
+    // Record timestamps are the video's own, so the creation time is left at 0.
+    TrajectoryLogWriter log;
+    if (!logPath.empty() &&
+        !openTrajectoryLog(log, logPath, frameSize, intrinsics->cameraMatrix, intrinsics->distCoeffs, 0))
+        return -1;
+    VideoWriter out;
+
+    vector<thread> workers;
+    for (unsigned t = 0; t < min<size_t>(numThreads, job.segments.size()); t++)
+        workers.emplace_back(worker, &job);
+
+    // Merge in order as soon as each segment is done. A failed segment
+    // still merges the frames it got through; the rest is reported.
+    long merged = 0, poses = 0;
+    double mergeSeconds = 0;
+    bool failed = false;
+    for (auto &s : job.segments) {
+        {
+            unique_lock<mutex> lock(job.doneMutex);
+            job.segmentDone.wait(lock, [&] { return s->done; });
+        }
+        if (!s->error.empty()) {
+            const string to = s->end == numeric_limits<long>::max() ? string("the end") : to_string(s->end - 1);
+            cerr << "Error: frames " << s->begin + (long)s->results.size() << " to " << to
+                 << " were not processed (" << s->error << ")." << endl;
+            failed = true;
+        }
+        for (const auto &r : s->results)
+            poses += r.poseValid ? 1 : 0;
+        auto m0 = chrono::steady_clock::now();
+        merged += mergeSegment(*s, log, out, outPath, job, frameSize);
+        mergeSeconds += chrono::duration<double>(chrono::steady_clock::now() - m0).count();
+    }
+    for (auto &w : workers)
+        w.join();
+    log.close();
+    out.release();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    cout << merged << " frames, " << poses << " poses in " << fixed << setprecision(2) << seconds << " s ("
+         << merged / seconds << " FPS), merging took " << mergeSeconds << " s" << endl;
+    if (!failed && merged < frameCount)
+        cerr << "Warning: the video ended " << frameCount - merged << " frames before its estimated length." << endl;
+    return failed ? 1 : 0;
+}
@@ -10,13 +10,26 @@ Project 4 - Calibration and Augmented Reality
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/features2d.hpp>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+
+#include "quality_governor.hpp"
 
 using namespace cv;
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
+    // Optional: "--target-fps <f>" lowers the feature budget when frames take
+    // longer than 1/f (see quality_governor.hpp).
+    double targetFps = 0;
+    for (int i = 1; i + 1 < argc; i++)
+        if (string(argv[i]) == "--target-fps")
+            targetFps = atof(argv[++i]);
+    QualityGovernor governor = QualityGovernor::forTargetFps(targetFps);
+
     // Open the default camera.
     VideoCapture cap(0);
     if (!cap.isOpened()){
@@ -51,6 +64,8 @@ int main()
             break;
         }
         
+        auto frameStart = chrono::steady_clock::now();
+
         // Convert to grayscale.
         cvtColor(frame, gray, COLOR_BGR2GRAY);
         
@@ -64,6 +79,11 @@ int main()
         drawKeypoints(frame, keypoints, output, Scalar(0, 255, 0), DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
         
         imshow(windowName, output);
+
+        if (governor.update(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count())) {
+            orb->setMaxFeatures(governor.settings().orbFeatures);
+            governor.print(cout);
+        }
         char key = (char)waitKey(30);
         if (key == 27) // ESC to exit
             break;
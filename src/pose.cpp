@@ -14,10 +14,15 @@ Project 4 - Calibration and Augmented Reality
 #include <vector>
 #include <utility>
 
+#include "corner_refine.hpp"
+#include "latest_frame.hpp"
+#include "pose_shm.hpp"
+#include "xcorner_detector.hpp"
+
 using namespace cv;
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
     // Load calibration parameters from file (using .yaml extension)
     FileStorage fs("../calibration/intrinsics.yaml", FileStorage::READ);
@@ -63,38 +68,62 @@ int main()
         {0, 4}, {1, 4}, {2, 4}, {3, 4}  // Side edges to apex
     };
 
-    // Open the default camera
-    VideoCapture cap(0);
-    if (!cap.isOpened()){
-        cerr << "Error: Could not open the camera." << endl;
-        return -1;
+    // Optional: publish every pose to shared memory (see pose_shm.hpp),
+    // e.g. "--publish" or "--publish /my_ring". "--low-latency" captures on
+    // its own thread and always processes the newest frame. "--xcorner" uses
+    // the 9x6 X-corner detector (see xcorner_detector.hpp). Its corners always
+    // start next to the dark corner square; findChessboardCorners may start at
+    // the opposite end, which turns the board origin and axes (and anything
+    // drawn from them) by 180 degrees.
+    PoseShmWriter poseWriter;
+    bool lowLatency = false;
+    bool useXCorner = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--publish") {
+            string name = (i + 1 < argc && argv[i + 1][0] == '/') ? argv[++i] : "/ar_pose";
+            if (poseWriter.open(name))
+                cout << "Publishing poses to shared memory " << name << endl;
+        }
+        else if (arg == "--low-latency")
+            lowLatency = true;
+        else if (arg == "--xcorner")
+            useXCorner = true;
     }
+    XCornerDetector<9, 6> xcorner;
+
+    // Open the default camera. With --low-latency a capture thread keeps only
+    // the newest frame (see latest_frame.hpp).
+    CameraSource camera;
+    if (!camera.open(0, lowLatency))
+        return -1;
+    LatencyMeter latency;
     const string windowName = "Camera Pose & Virtual Object (Pyramid)";
 
     while (true)
     {
         Mat frame, gray;
-        cap >> frame;
-        if (frame.empty()){
+        FrameStamp stamp;
+        if (!camera.read(frame, stamp)){
             cerr << "Error: Captured empty frame." << endl;
             break;
         }
+        int64_t captureNs = stamp.captureNs;
         cvtColor(frame, gray, COLOR_BGR2GRAY);
+        Mat rvec, tvec;
+        bool poseFound = false;
 
-        // Detect the checkerboard corners using a fast check to improve performance
+        // Detect the checkerboard corners using a fast check to improve
+        // performance, and refine them for increased accuracy.
         vector<Point2f> corners;
-        bool found = findChessboardCorners(gray, patternSize, corners,
-                                           CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
+        bool found = useXCorner ? xcorner.detect(gray, corners) : findBoardCorners(gray, patternSize, corners);
         if(found)
         {
-            // Refine corner locations for increased accuracy
-            cornerSubPix(gray, corners, Size(11, 11), Size(-1, -1),
-                         TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 30, 0.1));
             drawChessboardCorners(frame, patternSize, Mat(corners), found);
 
             // Estimate the camera pose using solvePnP.
-            Mat rvec, tvec;
             bool success = solvePnP(boardObjectPoints, corners, cameraMatrix, distCoeffs, rvec, tvec);
+            poseFound = success;
             if(success)
             {
                 // Draw coordinate axes on the board (axis length = 3 units)
@@ -116,14 +145,21 @@ int main()
                 cout << "Pose estimation failed." << endl;
             }
         }
+        if (poseFound)
+            publishPose(poseWriter, captureNs, POSE_DETECTED, rvec, tvec, corners);
+        else
+            publishPose(poseWriter, captureNs, POSE_LOST, Mat(), Mat(), vector<Point2f>());
+
         // Display the frame
         imshow(windowName, frame);
+        latency.displayed(stamp, camera.dropped());
         char key = (char)waitKey(10);
         if(key == 27) // ESC key to exit
             break;
     }
 
-    cap.release();
+    latency.report();
+    camera.release();
     destroyAllWindows();
     return 0;
 }
\ No newline at end of file
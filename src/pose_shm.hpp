@@ -0,0 +1,332 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Lock-free shared-memory pose ring (POSIX shm + seqlock slots).
+//
+// One writer process (pose, readobj, extension) publishes a PoseSample per
+// frame; any number of reader processes map the same segment read-only.
+// Each slot carries a sequence counter that is odd while the writer is
+// filling it, so readers never block the writer and simply retry when they
+// catch a slot mid-update. The header does not depend on OpenCV so consumers
+// such as a robot controller can include it on its own.
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint32_t kPoseShmMagic = 0x50534852; // "PSHR"
+static const uint32_t kPoseShmVersion = 1;
+static const int kPoseShmMaxCorners = 54;         // 9x6 board
+
+// Tracking state of a sample (same values as TrackState in board_tracker.hpp).
+enum PoseShmState : int32_t { POSE_LOST = 0, POSE_DETECTED = 1, POSE_TRACKED = 2 };
+
+// Monotonic clock shared by all processes on the machine, in nanoseconds.
+inline int64_t poseShmNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct PoseSample {
+    uint64_t frameIndex;       // writer's running frame counter
+    int64_t timestampNs;       // capture time (poseShmNowNs clock)
+    int64_t publishNs;         // time the sample was written
+    int32_t state;             // PoseShmState
+    int32_t cornerCount;
+    double rvec[3];
+    double tvec[3];
+    float corners[kPoseShmMaxCorners][2];
+};
+
+struct alignas(64) PoseShmSlot {
+    std::atomic<uint32_t> seq;
+    PoseSample sample;
+};
+
+struct alignas(64) PoseShmHeader {
+    std::atomic<uint32_t> magic;     // set last; 0 while the writer is initializing
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;
+    std::atomic<uint64_t> published; // number of samples written so far
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs lock-free 32-bit atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring index needs lock-free 64-bit atomics");
+
+inline size_t poseShmBytes(uint32_t capacity) {
+    return sizeof(PoseShmHeader) + (size_t)capacity * sizeof(PoseShmSlot);
+}
+
+inline PoseShmSlot* poseShmSlots(void* base) {
+    return reinterpret_cast<PoseShmSlot*>(static_cast<char*>(base) + sizeof(PoseShmHeader));
+}
+
+// -----------------------------------------------------------------------------
+// Writer side. Creates (or truncates) the segment and unlinks it on close.
+class PoseShmWriter {
+public:
+    PoseShmWriter() {}
+    ~PoseShmWriter() { close(); }
+    PoseShmWriter(const PoseShmWriter&) = delete;
+    PoseShmWriter& operator=(const PoseShmWriter&) = delete;
+
+    // 'name' is a POSIX shm name such as "/ar_pose". Capacity must be a power of two.
+    bool open(const std::string& name, uint32_t capacity = 256) {
+        close();
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            std::cerr << "Error: pose ring capacity must be a power of two." << std::endl;
+            return false;
+        }
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            std::cerr << "Error: shm_open failed for " << name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        size_t bytes = poseShmBytes(capacity);
+        if (ftruncate(fd, (off_t)bytes) != 0) {
+            std::cerr << "Error: ftruncate failed for " << name << ": " << strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            std::cerr << "Error: mmap failed for " << name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        std::memset(base, 0, bytes);
+
+        base_ = base;
+        bytes_ = bytes;
+        name_ = name;
+        header_ = static_cast<PoseShmHeader*>(base);
+        slots_ = poseShmSlots(base);
+        mask_ = capacity - 1;
+        header_->capacity = capacity;
+        header_->slotSize = sizeof(PoseShmSlot);
+        header_->version = kPoseShmVersion;
+        header_->published.store(0, std::memory_order_relaxed);
+        // Readers only trust the segment once the magic is visible.
+        header_->magic.store(kPoseShmMagic, std::memory_order_release);
+        return true;
+    }
+
+    void close() {
+        if (!base_)
+            return;
+        munmap(base_, bytes_);
+        shm_unlink(name_.c_str());
+        base_ = nullptr;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    // Publishes one sample. 'corners' holds cornerCount (x, y) pairs and may
+    // be null when no corners are available.
+    void publish(int64_t timestampNs, int32_t state, const double rvec[3], const double tvec[3],
+                 const float* corners, int cornerCount) {
+        if (!base_)
+            return;
+        uint64_t index = header_->published.load(std::memory_order_relaxed);
+        PoseShmSlot &slot = slots_[index & mask_];
+
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+
+        PoseSample &s = slot.sample;
+        s.frameIndex = index;
+        s.timestampNs = timestampNs;
+        s.state = state;
+        for (int i = 0; i < 3; i++) {
+            s.rvec[i] = rvec ? rvec[i] : 0.0;
+            s.tvec[i] = tvec ? tvec[i] : 0.0;
+        }
+        if (cornerCount > kPoseShmMaxCorners)
+            cornerCount = kPoseShmMaxCorners;
+        s.cornerCount = corners ? cornerCount : 0;
+        if (corners && cornerCount > 0)
+            std::memcpy(s.corners, corners, sizeof(float) * 2 * cornerCount);
+        s.publishNs = poseShmNowNs();
+
+        slot.seq.store(seq + 2, std::memory_order_release); // even: stable
+        header_->published.store(index + 1, std::memory_order_release);
+    }
+
+private:
+    void* base_ = nullptr;
+    size_t bytes_ = 0;
+    std::string name_;
+    PoseShmHeader* header_ = nullptr;
+    PoseShmSlot* slots_ = nullptr;
+    uint64_t mask_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Reader side. Maps the segment read-only and never writes to it, so any
+// number of readers can follow the same writer.
+class PoseShmReader {
+public:
+    PoseShmReader() {}
+    ~PoseShmReader() { close(); }
+    PoseShmReader(const PoseShmReader&) = delete;
+    PoseShmReader& operator=(const PoseShmReader&) = delete;
+
+    // Returns false quietly while the writer has not created or finished
+    // initializing the segment, so callers can simply poll.
+    bool open(const std::string& name) {
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return false; // writer not running yet
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PoseShmHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+            return false;
+
+        const PoseShmHeader* header = static_cast<const PoseShmHeader*>(base);
+        uint32_t magic = header->magic.load(std::memory_order_acquire);
+        if (magic == 0) {
+            munmap(base, (size_t)st.st_size); // writer still initializing
+            return false;
+        }
+        if (magic != kPoseShmMagic || header->version != kPoseShmVersion ||
+            header->slotSize != sizeof(PoseShmSlot) ||
+            (size_t)st.st_size < poseShmBytes(header->capacity)) {
+            std::cerr << "Error: " << name << " is not a compatible pose ring." << std::endl;
+            munmap(base, (size_t)st.st_size);
+            return false;
+        }
+        base_ = base;
+        bytes_ = (size_t)st.st_size;
+        header_ = header;
+        slots_ = poseShmSlots(base);
+        capacity_ = header->capacity;
+        cursor_ = header->published.load(std::memory_order_acquire);
+        return true;
+    }
+
+    void close() {
+        if (!base_)
+            return;
+        munmap(base_, bytes_);
+        base_ = nullptr;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    // Number of samples the writer has published so far.
+    uint64_t published() const {
+        return base_ ? header_->published.load(std::memory_order_acquire) : 0;
+    }
+
+    // Copies the newest sample. Returns false if nothing was published yet.
+    bool latest(PoseSample& out) const {
+        uint64_t n = published();
+        while (n > 0) {
+            if (readSlot(n - 1, out))
+                return true;
+            n = published(); // overwritten while copying, try the newer one
+        }
+        return false;
+    }
+
+    // Copies the next unread sample in order. Returns false when caught up.
+    // If the writer lapped the reader, skipped samples are added to lost().
+    bool next(PoseSample& out) {
+        while (true) {
+            uint64_t n = published();
+            if (cursor_ >= n)
+                return false;
+            if (n - cursor_ > capacity_) {
+                lost_ += n - cursor_ - capacity_;
+                cursor_ = n - capacity_;
+            }
+            if (readSlot(cursor_, out)) {
+                cursor_++;
+                return true;
+            }
+            // The slot is being recycled (or was left torn by a writer that
+            // died mid-update): that sample is gone, move past it.
+            if (published() - cursor_ <= capacity_) {
+                lost_++;
+                cursor_++;
+            }
+        }
+    }
+
+    uint64_t lost() const { return lost_; }
+
+private:
+    // Seqlock read of the slot that should hold sample 'index'.
+    bool readSlot(uint64_t index, PoseSample& out) const {
+        const PoseShmSlot &slot = slots_[index & (capacity_ - 1)];
+        for (int attempt = 0; attempt < 64; attempt++) {
+            uint32_t s1 = slot.seq.load(std::memory_order_acquire);
+            if (s1 & 1u)
+                continue; // writer is mid-update
+            std::memcpy(&out, &slot.sample, sizeof(PoseSample));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t s2 = slot.seq.load(std::memory_order_relaxed);
+            if (s1 == s2)
+                return out.frameIndex == index;
+        }
+        return false;
+    }
+
+    void* base_ = nullptr;
+    size_t bytes_ = 0;
+    const PoseShmHeader* header_ = nullptr;
+    const PoseShmSlot* slots_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+};
+
+#ifdef CV_VERSION
+// -----------------------------------------------------------------------------
+// Convenience for the OpenCV demos: publishes a solvePnP result and the
+// detected corners. Pass empty rvec/tvec when no pose is available.
+inline void publishPose(PoseShmWriter& writer, int64_t timestampNs, int32_t state,
+                        const cv::Mat& rvec, const cv::Mat& tvec,
+                        const std::vector<cv::Point2f>& corners) {
+    if (!writer.isOpen())
+        return;
+    double r[3] = {0, 0, 0}, t[3] = {0, 0, 0};
+    if (!rvec.empty() && !tvec.empty()) {
+        cv::Mat r64, t64;
+        rvec.convertTo(r64, CV_64F);
+        tvec.convertTo(t64, CV_64F);
+        for (int i = 0; i < 3; i++) {
+            r[i] = r64.at<double>(i);
+            t[i] = t64.at<double>(i);
+        }
+    }
+    writer.publish(timestampNs, state, r, t,
+                   corners.empty() ? nullptr : &corners[0].x, (int)corners.size());
+}
+#endif
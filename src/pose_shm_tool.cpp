@@ -0,0 +1,172 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Reader example and latency benchmark for the shared-memory pose ring.
+//
+// Usage:
+//   poseshm listen [name]                      print poses published by pose/readobj/extension
+//   poseshm bench [--samples n] [--rate hz]    writer + forked reader on this machine
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pose_shm.hpp"
+
+using namespace std;
+
+static const char* kStateNames[] = {"lost", "detected", "tracked"};
+
+// -----------------------------------------------------------------------------
+// Follows a running demo and prints every sample.
+static int listen(const string& name) {
+    PoseShmReader reader;
+    cout << "Waiting for publisher on " << name << " ..." << endl;
+    while (!reader.open(name))
+        this_thread::sleep_for(chrono::milliseconds(200));
+
+    PoseSample s;
+    uint64_t lastLost = 0;
+    while (true) {
+        if (!reader.next(s)) {
+            this_thread::sleep_for(chrono::microseconds(100));
+            continue;
+        }
+        double latencyUs = (poseShmNowNs() - s.timestampNs) / 1000.0;
+        const char* state = (s.state >= 0 && s.state <= 2) ? kStateNames[s.state] : "?";
+        printf("#%llu %-8s corners=%2d rvec=[%.3f %.3f %.3f] tvec=[%.2f %.2f %.2f] capture->read %.1f us\n",
+               (unsigned long long)s.frameIndex, state, s.cornerCount,
+               s.rvec[0], s.rvec[1], s.rvec[2], s.tvec[0], s.tvec[1], s.tvec[2], latencyUs);
+        if (reader.lost() != lastLost) {
+            lastLost = reader.lost();
+            printf("  (reader fell behind, %llu samples lost so far)\n", (unsigned long long)lastLost);
+        }
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+static void printPercentiles(const char* label, vector<double>& us) {
+    if (us.empty())
+        return;
+    sort(us.begin(), us.end());
+    auto pct = [&](double p) { return us[min(us.size() - 1, (size_t)(p * us.size()))]; };
+    printf("%-18s p50 %7.2f us   p90 %7.2f us   p99 %7.2f us   p99.9 %7.2f us   max %8.2f us\n",
+           label, pct(0.50), pct(0.90), pct(0.99), pct(0.999), us.back());
+}
+
+// Child process: reads every sample and measures publish->read latency.
+static int benchReader(const string& name, uint64_t samples) {
+    PoseShmReader reader;
+    if (!reader.open(name)) {
+        cerr << "Error: reader could not open " << name << endl;
+        return 1;
+    }
+    vector<double> publishToRead, captureToRead;
+    publishToRead.reserve(samples);
+    captureToRead.reserve(samples);
+
+    PoseSample s;
+    int64_t lastSeen = poseShmNowNs();
+    while (true) {
+        if (reader.next(s)) {
+            int64_t now = poseShmNowNs();
+            publishToRead.push_back((now - s.publishNs) / 1000.0);
+            captureToRead.push_back((now - s.timestampNs) / 1000.0);
+            lastSeen = now;
+            if (s.frameIndex + 1 >= samples)
+                break;
+        } else if (poseShmNowNs() - lastSeen > 2000000000LL) {
+            break; // writer gone
+        } else {
+            this_thread::yield();
+        }
+    }
+    printf("reader: %zu samples received, %llu lost\n", publishToRead.size(),
+           (unsigned long long)reader.lost());
+    printPercentiles("publish -> read", publishToRead);
+    printPercentiles("capture -> read", captureToRead);
+    fflush(stdout); // the child leaves with _exit()
+    return 0;
+}
+
+static int bench(uint64_t samples, double rateHz) {
+    const string name = "/ar_pose_bench_" + to_string(getpid());
+    PoseShmWriter writer;
+    if (!writer.open(name, 1024))
+        return 1;
+
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0)
+        _exit(benchReader(name, samples));
+
+    this_thread::sleep_for(chrono::milliseconds(200)); // let the reader attach
+
+    // Synthetic 54-corner samples. Sleep while far from the next due time and
+    // busy-wait the last stretch so the rate stays exact.
+    double rvec[3] = {0.1, -0.2, 0.05}, tvec[3] = {-4.0, 2.5, 30.0};
+    float corners[kPoseShmMaxCorners][2];
+    for (int i = 0; i < kPoseShmMaxCorners; i++) {
+        corners[i][0] = 100.0f + 20.0f * (i % 9);
+        corners[i][1] = 100.0f + 20.0f * (i / 9);
+    }
+    const int64_t periodNs = rateHz > 0 ? (int64_t)(1e9 / rateHz) : 0;
+    int64_t start = poseShmNowNs();
+    for (uint64_t i = 0; i < samples; i++) {
+        int64_t due = start + (int64_t)i * periodNs;
+        int64_t wait = due - poseShmNowNs();
+        if (wait > 200000)
+            this_thread::sleep_for(chrono::nanoseconds(wait - 100000));
+        while (poseShmNowNs() < due) {}
+        int64_t capture = poseShmNowNs();
+        tvec[0] += 0.001;
+        writer.publish(capture, POSE_TRACKED, rvec, tvec, &corners[0][0], kPoseShmMaxCorners);
+    }
+    double seconds = (poseShmNowNs() - start) / 1e9;
+    printf("writer: %llu samples in %.3f s (%.0f samples/s), sample size %zu bytes\n",
+           (unsigned long long)samples, seconds, samples / seconds, sizeof(PoseSample));
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    writer.close();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main(int argc, char** argv)
+{
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "listen")
+        return listen(argc > 2 ? argv[2] : "/ar_pose");
+
+    if (mode == "bench") {
+        uint64_t samples = 10000; // 10 s at the default rate
+        double rate = 1000.0;
+        for (int i = 2; i + 1 < argc; i += 2) {
+            string arg = argv[i];
+            if (arg == "--samples") samples = strtoull(argv[i + 1], nullptr, 10);
+            else if (arg == "--rate") rate = atof(argv[i + 1]);
+        }
+        return bench(samples, rate);
+    }
+
+    cerr << "Usage: poseshm listen [name]" << endl
+         << "       poseshm bench [--samples n] [--rate hz]   (rate 0 = as fast as possible)" << endl;
+    return -1;
+}
@@ -0,0 +1,139 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Adaptive quality governor: holds a frame time budget by stepping along a
+// ladder of quality levels, from full quality (level 0) to cheapest.
+//
+// Every frame the caller reports how long its processing took. The governor
+// keeps an exponential moving average of the frame time and moves one level
+// at a time, with hysteresis: it degrades after the average has exceeded the
+// budget for a short run of frames, upgrades only after a much longer run
+// comfortably under budget, and waits for a cooldown after every change so
+// the average can reflect the new settings. If an upgrade is undone soon
+// after, the next upgrade waits twice as long. Under a load spike quality
+// drops a step at a time instead of the frame rate collapsing, and it does
+// not oscillate between two levels at the edge of the budget.
+
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Every knob the demos expose. Level 0 matches their original hardcoded values.
+struct QualitySettings {
+    double detectScale = 1.0;    // detection image scale (multiplies the program's own scale)
+    int orbFeatures = 500;       // ORB feature budget
+    int refineIterations = 30;   // corner refinement iterations
+    int redetectInterval = 30;   // tracked frames between full detections (BoardTracker only)
+    int faceStride = 1;          // draw every n-th face of the wireframe
+};
+
+inline std::vector<QualitySettings> defaultQualityLadder() {
+    return {
+        // scale  orb  iters  redetect  stride
+        {1.00,   500,  30,    30,       1},
+        {0.80,   400,  20,    45,       1},
+        {0.65,   300,  12,    60,       2},
+        {0.50,   220,   8,    90,       2},
+        {0.40,   150,   5,   120,       3},
+        {0.33,   100,   3,   180,       4},
+    };
+}
+
+// -----------------------------------------------------------------------------
+class QualityGovernor {
+public:
+    // budgetMs <= 0 disables the governor: it stays at level 0.
+    explicit QualityGovernor(double budgetMs = 0.0,
+                             std::vector<QualitySettings> ladder = defaultQualityLadder())
+        : budgetMs_(budgetMs), ladder_(std::move(ladder)) {
+        if (ladder_.empty())
+            ladder_.push_back(QualitySettings());
+    }
+
+    static QualityGovernor forTargetFps(double fps) {
+        return QualityGovernor(fps > 0 ? 1000.0 / fps : 0.0);
+    }
+
+    // Reports the processing time of the last frame. Returns true when the
+    // level changed and the caller should apply settings().
+    bool update(double frameMs) {
+        if (budgetMs_ <= 0)
+            return false;
+        averageMs_ = averageMs_ <= 0 ? frameMs : averageMs_ + kAlpha * (frameMs - averageMs_);
+        framesSinceChange_++;
+        if (lastChangeUp_ && framesSinceChange_ == kUpgradeFrames)
+            upgradeWait_ = kUpgradeFrames; // the last upgrade held
+        if (cooldown_ > 0) {
+            cooldown_--;
+            return false;
+        }
+
+        if (averageMs_ > budgetMs_ * kDegradeAbove) {
+            overBudget_++;
+            underBudget_ = 0;
+        } else if (averageMs_ < budgetMs_ * kUpgradeBelow) {
+            underBudget_++;
+            overBudget_ = 0;
+        } else {
+            overBudget_ = underBudget_ = 0; // inside the dead band: hold
+        }
+
+        int next = level_;
+        if (overBudget_ >= kDegradeFrames && level_ + 1 < (int)ladder_.size())
+            next = level_ + 1;
+        else if (underBudget_ >= upgradeWait_ && level_ > 0)
+            next = level_ - 1;
+        if (next == level_)
+            return false;
+
+        if (next > level_ && lastChangeUp_ && framesSinceChange_ < kUpgradeFrames)
+            upgradeWait_ = std::min(upgradeWait_ * 2, kUpgradeFrames * 8); // bounced back
+        lastChangeUp_ = next < level_;
+        level_ = next;
+        framesSinceChange_ = 0;
+        overBudget_ = underBudget_ = 0;
+        cooldown_ = kCooldownFrames;
+        return true;
+    }
+
+    const QualitySettings& settings() const { return ladder_[level_]; }
+    int level() const { return level_; }
+    int levels() const { return (int)ladder_.size(); }
+    double averageMs() const { return averageMs_; }
+    double budgetMs() const { return budgetMs_; }
+    bool enabled() const { return budgetMs_ > 0; }
+
+    void print(std::ostream& os) const {
+        const QualitySettings &q = settings();
+        os << "Quality level " << level_ << "/" << levels() - 1 << " (avg " << averageMs_ << " ms, budget "
+           << budgetMs_ << " ms): scale " << q.detectScale << ", orb " << q.orbFeatures << ", iterations "
+           << q.refineIterations << ", redetect " << q.redetectInterval << ", face stride " << q.faceStride
+           << std::endl;
+    }
+
+private:
+    static constexpr double kAlpha = 0.1;          // EMA weight of the newest frame
+    static constexpr double kDegradeAbove = 1.0;   // fraction of the budget
+    static constexpr double kUpgradeBelow = 0.7;
+    static constexpr int kDegradeFrames = 10;
+    static constexpr int kUpgradeFrames = 90;
+    static constexpr int kCooldownFrames = 30;
+
+    double budgetMs_;
+    std::vector<QualitySettings> ladder_;
+    int level_ = 0;
+    double averageMs_ = 0;
+    int overBudget_ = 0, underBudget_ = 0, cooldown_ = 0;
+    int upgradeWait_ = kUpgradeFrames;
+    int framesSinceChange_ = 0;
+    bool lastChangeUp_ = false;
+};
@@ -10,93 +10,27 @@ Project 4 - Calibration and Augmented Reality
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/calib3d.hpp>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <utility>
 
+#include "ar_common.hpp"
+#include "corner_refine.hpp"
+#include "latest_frame.hpp"
+#include "overlay_cache.hpp"
+#include "pose_shm.hpp"
+#include "quality_governor.hpp"
+#include "scene.hpp"
+#include "trajectory_log.hpp"
+#include "xcorner_detector.hpp"
+
 using namespace cv;
 using namespace std;
 
-// Revised OBJ loader for vertices (v) and faces (f)
-// Handles face tokens with slashes and supports triangles and quadrilaterals.
-bool loadOBJ(const string& objFilePath, vector<Point3f>& outVertices, vector<Vec3i>& outFaces) {
-    ifstream file(objFilePath);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open OBJ file: " << objFilePath << endl;
-        return false;
-    }
-
-    cout << "Loading OBJ file: " << objFilePath << endl;
-    outVertices.clear();
-    outFaces.clear();
-
-    string line;
-    while (getline(file, line)) {
-        if (line.empty())
-            continue;
-
-        // Vertex line: "v x y z"
-        if (line.substr(0, 2) == "v ") {
-            istringstream iss(line);
-            char vLabel;
-            float x, y, z;
-            if (!(iss >> vLabel >> x >> y >> z)) {
-                cerr << "Error parsing vertex: " << line << endl;
-                continue;
-            }
-            outVertices.push_back(Point3f(x, y, z));
-        }
-        // Face line: can be triangle or quadrilateral with tokens like "1/1/1"
-        else if (line.substr(0, 2) == "f ") {
-            istringstream iss(line);
-            char fLabel;
-            iss >> fLabel; // Skip the 'f'
-            vector<int> vertexIndices;
-            string token;
-            while (iss >> token) {
-                // Token might be "1/1/1" or similar.
-                istringstream tokenStream(token);
-                string indexStr;
-                if (getline(tokenStream, indexStr, '/')) {
-                    try {
-                        int index = stoi(indexStr);
-                        vertexIndices.push_back(index - 1); // Convert to 0-based index.
-                    } catch (exception& e) {
-                        cerr << "Error converting token to integer: " << token << endl;
-                    }
-                }
-            }
-            // Triangulate: if three indices, use one triangle; if four, split into two triangles.
-            if (vertexIndices.size() == 3) {
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
-            } else if (vertexIndices.size() == 4) {
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[1], vertexIndices[2]));
-                outFaces.push_back(Vec3i(vertexIndices[0], vertexIndices[2], vertexIndices[3]));
-            } else {
-                cerr << "Face with unsupported number of vertices: " << vertexIndices.size() << endl;
-            }
-        }
-    }
-    file.close();
-
-    cout << "OBJ loaded: " << outVertices.size() << " vertices, " << outFaces.size() << " faces." << endl;
-    return true;
-}
-
-// Optional function to scale/translate the model so it appears above the board.
-void adjustModel(vector<Point3f>& vertices, float scale, float zOffset) {
-    for (auto &v : vertices) {
-        v.x *= scale;
-        v.y *= scale;
-        v.z *= scale;
-        v.z += zOffset;
-    }
-}
-
-int main()
+int main(int argc, char** argv)
 {
     // Load calibration parameters from file (using .yaml extension)
     FileStorage fs("../calibration/intrinsics.yaml", FileStorage::READ);
@@ -124,103 +58,173 @@ int main()
         }
     }
 
-    // Load the OBJ model.
-    string objFilePath = "../models/newcar.obj";
-    vector<Point3f> objVertices;
-    vector<Vec3i> objFaces;
-    if (!loadOBJ(objFilePath, objVertices, objFaces)) {
-        return -1;
+    // Options:
+    //   --scene <file>        render an instanced scene (see scene.hpp)
+    //   --publish [name]      publish every pose to shared memory (see pose_shm.hpp)
+    //   --record <log>        write a trajectory log for the replay tool
+    //   --record-video <file> save the raw camera frames next to the log
+    //   --low-latency         capture on its own thread, always process the newest frame
+    //   --no-overlay-cache    redraw the overlay every frame even when the pose is unchanged
+    //   --no-cull             project and draw the whole scene, also the parts outside the image
+    //   --target-fps <f>      trade detection scale, refinement and wireframe detail for f FPS
+    //   --xcorner             use the 9x6 X-corner detector (see xcorner_detector.hpp);
+    //                         its origin is always the dark corner square, which
+    //                         findChessboardCorners does not guarantee, so the
+    //                         model can appear turned 180 degrees between them
+    PoseShmWriter poseWriter;
+    TrajectoryLogWriter trajectoryLog;
+    VideoWriter rawVideo;
+    string recordPath, recordVideoPath, scenePath;
+    bool lowLatency = false;
+    bool overlayCacheEnabled = true;
+    bool cullingEnabled = true;
+    double targetFps = 0;
+    bool useXCorner = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--publish") {
+            string name = (i + 1 < argc && argv[i + 1][0] == '/') ? argv[++i] : "/ar_pose";
+            if (poseWriter.open(name))
+                cout << "Publishing poses to shared memory " << name << endl;
+        }
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--record-video" && i + 1 < argc)
+            recordVideoPath = argv[++i];
+        else if (arg == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (arg == "--low-latency")
+            lowLatency = true;
+        else if (arg == "--no-overlay-cache")
+            overlayCacheEnabled = false;
+        else if (arg == "--no-cull")
+            cullingEnabled = false;
+        else if (arg == "--target-fps" && i + 1 < argc)
+            targetFps = atof(argv[++i]);
+        else if (arg == "--xcorner")
+            useXCorner = true;
     }
 
-    // Optionally adjust the model so it appears above the board.
-    // For instance, scale by 1.0 and translate up by 5.0 units in z.
-    adjustModel(objVertices, 1.0f, 5.0f);
-
-    // Open the default camera.
-    VideoCapture cap(0);
-    if (!cap.isOpened()){
-        cerr << "Error: Could not open the camera." << endl;
+    // Load the scene. Without --scene this is the car model scaled by 1.0
+    // and translated up by 5.0 units in z so it appears above the board.
+    Scene scene;
+    bool sceneLoaded = scenePath.empty() ? makeSingleModelScene("../models/newcar.obj", 1.0f, 5.0f, scene)
+                                         : loadScene(scenePath, scene);
+    if (!sceneLoaded)
         return -1;
-    }
+    // Skips the parts of the scene outside the image (see mesh_bvh.hpp).
+    SceneProjector sceneProjector;
+    sceneProjector.setCulling(cullingEnabled);
+
+    // Reuses the drawn overlay while the pose stays put (see overlay_cache.hpp).
+    OverlayCache overlayCache;
+    overlayCache.setEnabled(overlayCacheEnabled);
+
+    // Quality knobs; fixed at full quality unless --target-fps is given.
+    QualityGovernor governor = QualityGovernor::forTargetFps(targetFps);
+    CornerRefineParams refineParams;
+    XCornerDetector<9, 6> xcorner;
+
+    // Sends one frame's result to every enabled output.
+    int64_t captureNs = 0;
+    uint32_t frameIndex = 0;
+    auto reportPose = [&](int16_t state, const Mat& rvec, const Mat& tvec, const vector<Point2f>& points) {
+        publishPose(poseWriter, captureNs, state, rvec, tvec, points);
+        logFrame(trajectoryLog, captureNs, frameIndex, state, rvec, tvec, points);
+    };
+    long framesRead = 0;
+
+    // Open the default camera. With --low-latency a capture thread keeps only
+    // the newest frame (see latest_frame.hpp).
+    CameraSource camera;
+    if (!camera.open(0, lowLatency))
+        return -1;
+    LatencyMeter latency;
     const string windowName = "OBJ Model AR";
     
     while (true)
     {
         Mat frame, gray;
-        cap >> frame;
-        if (frame.empty()){
+        FrameStamp stamp;
+        if (!camera.read(frame, stamp)){
             cerr << "Error: Captured empty frame." << endl;
             break;
         }
+        captureNs = stamp.captureNs;
+        auto frameStart = chrono::steady_clock::now();
+        frameIndex = (uint32_t)framesRead++;
+
+        // Recorders are opened on the first frame, once the frame size is known.
+        if (frameIndex == 0) {
+            if (!recordPath.empty() &&
+                openTrajectoryLog(trajectoryLog, recordPath, frame.size(), cameraMatrix, distCoeffs, captureNs))
+                cout << "Recording trajectory log to " << recordPath << endl;
+            if (!recordVideoPath.empty() &&
+                !rawVideo.open(recordVideoPath, VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, frame.size()))
+                cerr << "Error: Could not open " << recordVideoPath << " for writing." << endl;
+        }
+        if (rawVideo.isOpened())
+            rawVideo.write(frame);
         cvtColor(frame, gray, COLOR_BGR2GRAY);
 
-        // Detect the checkerboard corners using a fast check.
+        // Detect the checkerboard corners using a fast check (on a downscaled
+        // copy when the governor asks for it) and refine them. The X-corner
+        // detector is cheap enough to always run at full resolution.
         vector<Point2f> corners;
-        bool found = findChessboardCorners(gray, patternSize, corners,
-            CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
-        if(found && (int)corners.size() == patternSize.area())
+        const QualitySettings &quality = governor.settings();
+        bool found = useXCorner ? xcorner.detect(gray, corners)
+                                : findBoardCorners(gray, patternSize, corners, quality.detectScale, refineParams);
+        if(found)
         {
-            // Refine the corner locations.
-            cornerSubPix(gray, corners, Size(11, 11), Size(-1, -1),
-                         TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 30, 0.1));
             drawChessboardCorners(frame, patternSize, Mat(corners), found);
 
             // Estimate the camera pose using solvePnP.
             Mat rvec, tvec;
             bool success = solvePnP(boardObjectPoints, corners, cameraMatrix, distCoeffs, rvec, tvec);
+            if (success)
+                reportPose(POSE_DETECTED, rvec, tvec, corners);
+            else
+                reportPose(POSE_LOST, Mat(), Mat(), corners);
             if(success)
             {
-                // Draw coordinate axes on the board (axis length = 3 units).
-                drawFrameAxes(frame, cameraMatrix, distCoeffs, rvec, tvec, 3);
-
-                // Project the OBJ model vertices into the image plane.
-                vector<Point2f> projectedPoints;
-                projectPoints(objVertices, rvec, tvec, cameraMatrix, distCoeffs, projectedPoints);
-
-                // Verify that the projected points vector size matches the number of vertices.
-                if(projectedPoints.size() != objVertices.size()){
-                    cerr << "Error: projectedPoints size (" << projectedPoints.size()
-                         << ") does not match objVertices size (" << objVertices.size() << ")." << endl;
-                    continue;
-                }
-
-                // Draw the OBJ model in a wireframe style using the triangular faces.
-                for (size_t i = 0; i < objFaces.size(); i++){
-                    int i1 = objFaces[i][0];
-                    int i2 = objFaces[i][1];
-                    int i3 = objFaces[i][2];
-
-                    // Verify that indices are within bounds.
-                    if(i1 < 0 || i1 >= projectedPoints.size() ||
-                       i2 < 0 || i2 >= projectedPoints.size() ||
-                       i3 < 0 || i3 >= projectedPoints.size()){
-                        cerr << "Face " << i << " has invalid indices: " 
-                             << i1 << ", " << i2 << ", " << i3 << endl;
-                        continue;
-                    }
-
-                    Point pt1 = projectedPoints[i1];
-                    Point pt2 = projectedPoints[i2];
-                    Point pt3 = projectedPoints[i3];
-
-                    // Draw triangle edges for a wireframe look.
-                    line(frame, pt1, pt2, Scalar(255, 255, 255), 2);
-                    line(frame, pt2, pt3, Scalar(255, 255, 255), 2);
-                    line(frame, pt3, pt1, Scalar(255, 255, 255), 2);
-                }
+                overlayCache.render(frame, rvec, tvec, [&](Mat& target) {
+                    // Draw coordinate axes on the board (axis length = 3 units).
+                    Rect drawn = drawAxes(target, cameraMatrix, distCoeffs, rvec, tvec, 3);
+
+                    // Project every model instance in one batch and draw the wireframes.
+                    sceneProjector.project(scene, rvec, tvec, cameraMatrix, distCoeffs, target.size());
+                    return drawn | sceneProjector.draw(target, scene, Scalar(255, 255, 255), 2, quality.faceStride);
+                });
             }
             else {
                 cout << "Pose estimation failed." << endl;
             }
         }
+        else {
+            reportPose(POSE_LOST, Mat(), Mat(), vector<Point2f>());
+        }
 
         imshow(windowName, frame);
+        latency.displayed(stamp, camera.dropped());
+
+        if (governor.update(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count())) {
+            refineParams.maxIterations = governor.settings().refineIterations;
+            xcorner.setRefineParams(refineParams);
+            overlayCache.invalidate(); // the wireframe detail may have changed
+            governor.print(cout);
+        }
         char key = (char)waitKey(10);
         if(key == 27) // ESC key to exit
             break;
     }
 
-    cap.release();
+    trajectoryLog.close();
+    rawVideo.release();
+    latency.report();
+    if (overlayCache.enabled())
+        cout << "Overlay cache: reused " << overlayCache.hits() << " of "
+             << overlayCache.hits() + overlayCache.misses() << " overlays." << endl;
+    camera.release();
     destroyAllWindows();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Accuracy and speed of refineCorners (corner_refine.hpp) against
+// cornerSubPix on synthetic 9x6 boards with known sub-pixel corners.
+//
+// Boards come from synthetic_board.hpp. Initial corners come from
+// findChessboardCorners, as in the demos.
+//
+// Usage: refinebench [--samples n] [--noise sigma]
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corner_refine.hpp"
+#include "synthetic_board.hpp"
+
+using namespace cv;
+using namespace std;
+
+struct Sample {
+    Mat gray;
+    vector<Point2f> truth;    // row-major ground truth
+    vector<Point2f> initial;  // findChessboardCorners output, reordered to match truth
+};
+
+struct MethodResult {
+    string name;
+    double sqErr = 0, maxErr = 0, micros = 0;
+    long corners = 0, boards = 0;
+};
+
+// One board from renderSyntheticBoard with findChessboardCorners' output as
+// the starting point, reordered to match the ground truth.
+static bool makeSample(Size patternSize, double squarePx, double noiseSigma, mt19937& rng, Sample& out) {
+    renderSyntheticBoard(patternSize, squarePx, noiseSigma, 0.5, rng, out.gray, out.truth);
+
+    vector<Point2f> found;
+    if (!findChessboardCorners(out.gray, patternSize, found,
+                               CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK))
+        return false;
+    // Detected order may be reversed: match every truth corner to its nearest detection.
+    out.initial.assign(out.truth.size(), Point2f());
+    for (size_t i = 0; i < out.truth.size(); i++) {
+        double best = 1e9;
+        for (const auto &f : found) {
+            double d = norm(f - out.truth[i]);
+            if (d < best) { best = d; out.initial[i] = f; }
+        }
+        if (best > 3.0)
+            return false;
+    }
+    return true;
+}
+
+static void accumulate(MethodResult& m, const vector<Point2f>& refined, const vector<Point2f>& truth, double micros) {
+    for (size_t i = 0; i < truth.size(); i++) {
+        double e = norm(refined[i] - truth[i]);
+        m.sqErr += e * e;
+        m.maxErr = max(m.maxErr, e);
+    }
+    m.corners += (long)truth.size();
+    m.boards++;
+    m.micros += micros;
+}
+
+int main(int argc, char** argv)
+{
+    int samples = 50;
+    double noise = 2.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--samples") samples = atoi(argv[i + 1]);
+        else if (arg == "--noise") noise = atof(argv[i + 1]);
+    }
+
+    const Size patternSize(9, 6);
+    const int repeats = 20; // timing repetitions per board
+    mt19937 rng(5330);
+
+    cout << "Synthetic 9x6 boards, " << samples << " per size, noise sigma " << noise << endl;
+    for (double squarePx : {12.0, 20.0, 35.0, 50.0}) {
+        vector<MethodResult> methods(4);
+        methods[0].name = "cornerSubPix 11x11";
+        methods[1].name = "refineCorners h=5";
+        methods[2].name = "refineCorners adaptive";
+        methods[3].name = "refineCorners adaptive MT";
+        int windowSum = 0, made = 0;
+
+        for (int s = 0, attempts = 0; s < samples && attempts < samples * 5; attempts++) {
+            Sample sample;
+            if (!makeSample(patternSize, squarePx, noise, rng, sample))
+                continue;
+            s++;
+            made++;
+
+            for (size_t m = 0; m < methods.size(); m++) {
+                vector<Point2f> refined;
+                auto t0 = chrono::steady_clock::now();
+                for (int r = 0; r < repeats; r++) {
+                    refined = sample.initial;
+                    if (m == 0) {
+                        cornerSubPix(sample.gray, refined, Size(11, 11), Size(-1, -1),
+                                     TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 30, 0.1));
+                    } else {
+                        CornerRefineParams params;
+                        params.fixedHalfWindow = (m == 1) ? 5 : 0;
+                        params.parallel = (m == 3);
+                        CornerRefineStats stats = refineCorners(sample.gray, refined, patternSize, params);
+                        if (m == 2 && r == 0)
+                            windowSum += stats.halfWindow;
+                    }
+                }
+                double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count() / repeats;
+                accumulate(methods[m], refined, sample.truth, micros);
+            }
+        }
+
+        cout << endl << "square ~" << squarePx << " px (" << made << " boards detected, adaptive half window ~"
+             << (made ? windowSum / made : 0) << " px)" << endl;
+        cout << left << setw(28) << "method" << right << setw(12) << "RMS px" << setw(12) << "max px"
+             << setw(14) << "us/board" << endl;
+        for (const auto &m : methods) {
+            if (m.corners == 0)
+                continue;
+            cout << left << setw(28) << m.name << right << fixed << setprecision(4)
+                 << setw(12) << sqrt(m.sqErr / m.corners) << setw(12) << m.maxErr
+                 << setprecision(1) << setw(14) << m.micros / m.boards << endl;
+        }
+    }
+    return 0;
+}
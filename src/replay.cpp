@@ -0,0 +1,268 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Re-renders AR overlays from a trajectory log recorded by readobj or
+// extension (--record). No detection runs here: poses come straight from
+// the memory-mapped log, so re-rendering is bounded by drawing speed.
+//
+// Usage:
+//   replay <log.artrj> [--video <file>] [--model <obj>] [--scale s] [--zoffset z]
+//          [--start n] [--out <file>] [--headless] [--cache-stats]
+//
+// --cache-stats renders nothing: it reports how often OverlayCache
+// (overlay_cache.hpp) would reuse the overlay on the logged poses at a few
+// thresholds, and how far a reused overlay could be off, so the thresholds
+// can be picked from a real recording.
+//
+// Keys (interactive): space pause/resume, 'a'/'d' step back/forward while
+// paused, the "frame" trackbar seeks anywhere in O(1), ESC quits.
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ar_common.hpp"
+#include "overlay_cache.hpp"
+#include "trajectory_log.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Draws one logged frame: corners, axes and the model wireframe.
+static void renderRecord(Mat& canvas, const TrajectoryLogReader& log, uint64_t i,
+                         const Mat& cameraMatrix, const Mat& distCoeffs,
+                         const vector<Point3f>& vertices, const vector<Vec3i>& faces,
+                         vector<Point2f>& projected) {
+    const TrajectoryRecord& r = log.record(i);
+    const float* c = log.corners(i);
+    for (int k = 0; k < r.cornerCount; k++)
+        circle(canvas, Point2f(c[2 * k], c[2 * k + 1]), 4, Scalar(0, 0, 255), -1);
+
+    if (r.state == 0)
+        return; // lost: no pose was logged
+    Mat rvec = (Mat_<double>(3, 1) << r.rvec[0], r.rvec[1], r.rvec[2]);
+    Mat tvec = (Mat_<double>(3, 1) << r.tvec[0], r.tvec[1], r.tvec[2]);
+    drawFrameAxes(canvas, cameraMatrix, distCoeffs, rvec, tvec, 3);
+    if (!vertices.empty()) {
+        projectPoints(vertices, rvec, tvec, cameraMatrix, distCoeffs, projected);
+        drawWireframe(canvas, projected, faces, Scalar(255, 255, 255), 2);
+    }
+}
+
+// Replays the cache decision over every logged pose. The shift of a reused
+// overlay is measured on the axis end points and the model's bounding box
+// corners: the largest distance between where they were drawn and where the
+// current pose would put them.
+static void printCacheStats(const TrajectoryLogReader& log, const Mat& cameraMatrix, const Mat& distCoeffs,
+                            const vector<Point3f>& vertices) {
+    vector<Point3f> probes = {Point3f(0, 0, 0), Point3f(3, 0, 0), Point3f(0, 3, 0), Point3f(0, 0, 3)};
+    if (!vertices.empty()) {
+        Point3f lo = vertices[0], hi = vertices[0];
+        for (const Point3f &v : vertices) {
+            lo = Point3f(min(lo.x, v.x), min(lo.y, v.y), min(lo.z, v.z));
+            hi = Point3f(max(hi.x, v.x), max(hi.y, v.y), max(hi.z, v.z));
+        }
+        for (int k = 0; k < 8; k++)
+            probes.push_back(Point3f((k & 1) ? hi.x : lo.x, (k & 2) ? hi.y : lo.y, (k & 4) ? hi.z : lo.z));
+    }
+
+    const double thresholds[][2] = {{0.005, 0.025}, {0.01, 0.05}, {0.02, 0.1}, {0.05, 0.2}};
+    cout << "Overlay cache on " << log.size() << " logged frames (defaults 0.01 units, 0.05 deg):" << endl;
+    for (const auto &th : thresholds) {
+        OverlayCache cache(th[0], th[1]);
+        Matx33d R0, R;
+        Vec3d t0, t;
+        vector<Point2f> drawnAt, now;
+        bool valid = false;
+        long poses = 0, hits = 0;
+        double worstShift = 0;
+        for (uint64_t i = 0; i < log.size(); i++) {
+            const TrajectoryRecord& r = log.record(i);
+            if (r.state == 0)
+                continue; // no overlay is drawn; the cached layer stays
+            Mat rvec = (Mat_<double>(3, 1) << r.rvec[0], r.rvec[1], r.rvec[2]);
+            Mat tvec = (Mat_<double>(3, 1) << r.tvec[0], r.tvec[1], r.tvec[2]);
+            OverlayCache::toPose(rvec, tvec, R, t);
+            poses++;
+            if (valid && cache.reusable(R0, t0, R, t)) {
+                hits++;
+                projectPoints(probes, rvec, tvec, cameraMatrix, distCoeffs, now);
+                for (size_t k = 0; k < probes.size(); k++)
+                    worstShift = max(worstShift, (double)norm(now[k] - drawnAt[k]));
+            } else {
+                R0 = R;
+                t0 = t;
+                projectPoints(probes, rvec, tvec, cameraMatrix, distCoeffs, drawnAt);
+                valid = true;
+            }
+        }
+        cout << "  translation <= " << th[0] << ", rotation <= " << th[1] << " deg: reused " << hits << " of "
+             << poses << " overlays (" << 100.0 * hits / max(1L, poses) << "%), largest shift "
+             << worstShift << " px" << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cerr << "Usage: replay <log.artrj> [--video file] [--model obj] [--scale s] [--zoffset z]"
+             << " [--start n] [--out file] [--headless] [--cache-stats]" << endl;
+        return -1;
+    }
+    string logPath = argv[1];
+    string videoPath, outPath;
+    string modelPath = "../models/newcar.obj";
+    float scale = 1.0f, zOffset = 5.0f;
+    uint64_t start = 0;
+    bool headless = false;
+    bool cacheStats = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--video" && hasValue) videoPath = argv[++i];
+        else if (arg == "--model" && hasValue) modelPath = argv[++i];
+        else if (arg == "--scale" && hasValue) scale = (float)atof(argv[++i]);
+        else if (arg == "--zoffset" && hasValue) zOffset = (float)atof(argv[++i]);
+        else if (arg == "--start" && hasValue) start = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--headless") headless = true;
+        else if (arg == "--cache-stats") cacheStats = true;
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return -1;
+        }
+    }
+
+    TrajectoryLogReader log;
+    if (!log.open(logPath))
+        return -1;
+    if (log.size() == 0) {
+        cerr << "Error: " << logPath << " contains no frames." << endl;
+        return -1;
+    }
+    const TrajectoryLogHeader& header = log.header();
+    cout << "Trajectory log: " << log.size() << " frames, " << header.frameWidth << "x" << header.frameHeight << endl;
+
+    Mat cameraMatrix, distCoeffs;
+    trajectoryIntrinsics(header, cameraMatrix, distCoeffs);
+
+    vector<Point3f> vertices;
+    vector<Vec3i> faces;
+    if (!modelPath.empty() && modelPath != "none") {
+        if (!loadOBJ(modelPath, vertices, faces))
+            return -1;
+        adjustModel(vertices, scale, zOffset);
+    }
+    if (cacheStats) {
+        printCacheStats(log, cameraMatrix, distCoeffs, vertices);
+        return 0;
+    }
+
+    VideoCapture cap;
+    if (!videoPath.empty() && !cap.open(videoPath)) {
+        cerr << "Error: Could not open video " << videoPath << endl;
+        return -1;
+    }
+    long videoPos = -1; // index of the next frame cap.read() will return
+    Mat source;         // last decoded source frame, reused while paused
+    long sourceFrame = -1;
+
+    VideoWriter writer;
+    Size frameSize((int)header.frameWidth, (int)header.frameHeight);
+    if (!outPath.empty() &&
+        !writer.open(outPath, VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, frameSize)) {
+        cerr << "Error: Could not open output video " << outPath << endl;
+        return -1;
+    }
+
+    const string windowName = "Trajectory Replay";
+    int trackbarPos = (int)min<uint64_t>(start, log.size() - 1);
+    if (!headless) {
+        namedWindow(windowName, WINDOW_AUTOSIZE);
+        createTrackbar("frame", windowName, &trackbarPos, (int)log.size() - 1);
+    }
+    log.adviseSequential(headless);
+
+    Mat canvas, blank(frameSize, CV_8UC3, Scalar(0, 0, 0));
+    vector<Point2f> projected;
+    uint64_t i = min<uint64_t>(start, log.size() - 1);
+    bool paused = false;
+    long rendered = 0;
+    auto t0 = chrono::steady_clock::now();
+
+    while (i < log.size()) {
+        const TrajectoryRecord& r = log.record(i);
+
+        // Source frame: decode only when it changed, and seek only when not
+        // already positioned on it. While paused the cached frame is reused.
+        if (cap.isOpened()) {
+            if (sourceFrame != (long)r.frameIndex) {
+                if (videoPos != (long)r.frameIndex) {
+                    cap.set(CAP_PROP_POS_FRAMES, r.frameIndex);
+                    videoPos = r.frameIndex;
+                }
+                if (!cap.read(source) || source.empty()) {
+                    cerr << "Error: Video ended before the log (frame " << r.frameIndex << ")." << endl;
+                    break;
+                }
+                videoPos++;
+                sourceFrame = r.frameIndex;
+            }
+            source.copyTo(canvas);
+        } else {
+            blank.copyTo(canvas);
+        }
+
+        renderRecord(canvas, log, i, cameraMatrix, distCoeffs, vertices, faces, projected);
+        rendered++;
+        if (writer.isOpened())
+            writer.write(canvas);
+
+        if (headless) {
+            i++;
+            continue;
+        }
+
+        putText(canvas, "frame " + to_string(i) + "/" + to_string(log.size() - 1), Point(10, 30),
+                FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 255, 0), 2);
+        imshow(windowName, canvas);
+        const int shownPos = (int)i;
+        setTrackbarPos("frame", windowName, shownPos);
+
+        // While paused, keep polling so trackbar moves are picked up.
+        // Each iteration re-renders the current frame, since a step only changes 'i'.
+        char key = (char)waitKey(paused ? 30 : 1);
+        int pos = getTrackbarPos("frame", windowName);
+        if (key == 27) // ESC to exit
+            break;
+        else if (pos != shownPos && pos >= 0 && (uint64_t)pos < log.size())
+            i = (uint64_t)pos; // the user dragged the trackbar: O(1) jump
+        else if (key == ' ')
+            paused = !paused;
+        else if (key == 'a' && paused && i > 0)
+            i--;
+        else if (key == 'd' && paused && i + 1 < log.size())
+            i++;
+        else if (!paused)
+            i++;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    cout << "Rendered " << rendered << " frames in " << seconds << " s (" << rendered / max(seconds, 1e-9)
+         << " FPS)." << endl;
+
+    writer.release();
+    cap.release();
+    destroyAllWindows();
+    return 0;
+}
@@ -0,0 +1,477 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Instanced scenes: a few meshes, each loaded once, placed many times on the
+// board (e.g. a parking lot of cars).
+//
+// Scene file, one entry per line ('#' starts a comment):
+//   mesh     <name> <obj path>
+//   instance <mesh name> <x> <y> <z> [rotation about board z, degrees] [scale]
+//
+// SceneProjector projects all instances for a board pose in one batch.
+// Each instance transform is folded into the board pose to form one 3x4 matrix,
+// so the shared mesh vertices are never copied. The work is split into
+// (instance, vertex range) chunks that run on OpenCV's thread pool.
+//
+// Given the image size, SceneProjector also culls against the view frustum.
+// Each mesh gets a triangle BVH at load time (mesh_bvh.hpp). Only the
+// vertices of leaves that may be visible are projected, and only their
+// triangles are drawn. This matters when the camera is close to the board
+// and a large model fills far more than the image.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ar_common.hpp"
+#include "mesh_bvh.hpp"
+
+struct SceneMesh {
+    std::string name;
+    std::vector<cv::Point3f> vertices;
+    std::vector<cv::Vec3i> faces;
+    MeshBVH bvh;                  // built by prepareMesh()
+};
+
+struct SceneInstance {
+    int mesh = 0;                 // index into Scene::meshes
+    cv::Point3f translation;      // board units
+    float rotationDeg = 0.0f;     // about the board z axis
+    float scale = 1.0f;
+};
+
+struct Scene {
+    std::vector<SceneMesh> meshes;
+    std::vector<SceneInstance> instances;
+
+    size_t totalVertices() const {
+        size_t n = 0;
+        for (const auto &inst : instances)
+            n += meshes[inst.mesh].vertices.size();
+        return n;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Reports faces that point past the vertex list once at load time; they are
+// skipped when drawing.
+inline void checkMeshFaces(const SceneMesh& mesh) {
+    const int n = (int)mesh.vertices.size();
+    size_t bad = 0;
+    for (const auto &f : mesh.faces)
+        if (f[0] < 0 || f[0] >= n || f[1] < 0 || f[1] >= n || f[2] < 0 || f[2] >= n)
+            bad++;
+    if (bad > 0)
+        std::cerr << "Warning: mesh '" << mesh.name << "' has " << bad << " faces with invalid indices." << std::endl;
+}
+
+// Load-time work for a freshly read mesh: face check and culling BVH.
+inline void prepareMesh(SceneMesh& mesh) {
+    checkMeshFaces(mesh);
+    mesh.bvh.build(mesh.vertices, mesh.faces);
+}
+
+// -----------------------------------------------------------------------------
+// Single model scene, equivalent to adjustModel(vertices, scale, zOffset).
+inline bool makeSingleModelScene(const std::string& objPath, float scale, float zOffset, Scene& scene) {
+    scene = Scene();
+    SceneMesh mesh;
+    mesh.name = "model";
+    if (!loadOBJ(objPath, mesh.vertices, mesh.faces))
+        return false;
+    prepareMesh(mesh);
+    scene.meshes.push_back(std::move(mesh));
+    SceneInstance inst;
+    inst.translation = cv::Point3f(0, 0, zOffset);
+    inst.scale = scale;
+    scene.instances.push_back(inst);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Parses a scene file. A mesh referenced by many instances is loaded once.
+inline bool loadScene(const std::string& path, Scene& scene) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open scene file: " << path << std::endl;
+        return false;
+    }
+    scene = Scene();
+    std::map<std::string, int> meshByName;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line = line.substr(0, hash);
+        std::istringstream iss(line);
+        std::string keyword;
+        if (!(iss >> keyword))
+            continue;
+
+        if (keyword == "mesh") {
+            SceneMesh mesh;
+            std::string objPath;
+            if (!(iss >> mesh.name >> objPath)) {
+                std::cerr << "Error: " << path << ":" << lineNo << ": expected 'mesh <name> <obj>'" << std::endl;
+                return false;
+            }
+            if (meshByName.count(mesh.name)) {
+                std::cerr << "Error: " << path << ":" << lineNo << ": mesh '" << mesh.name << "' defined twice" << std::endl;
+                return false;
+            }
+            if (!loadOBJ(objPath, mesh.vertices, mesh.faces))
+                return false;
+            prepareMesh(mesh);
+            meshByName[mesh.name] = (int)scene.meshes.size();
+            scene.meshes.push_back(std::move(mesh));
+        } else if (keyword == "instance") {
+            std::string meshName;
+            SceneInstance inst;
+            if (!(iss >> meshName >> inst.translation.x >> inst.translation.y >> inst.translation.z)) {
+                std::cerr << "Error: " << path << ":" << lineNo << ": expected 'instance <mesh> <x> <y> <z>'" << std::endl;
+                return false;
+            }
+            auto it = meshByName.find(meshName);
+            if (it == meshByName.end()) {
+                std::cerr << "Error: " << path << ":" << lineNo << ": unknown mesh '" << meshName << "'" << std::endl;
+                return false;
+            }
+            inst.mesh = it->second;
+            if (iss >> inst.rotationDeg)
+                iss >> inst.scale;
+            scene.instances.push_back(inst);
+        } else {
+            std::cerr << "Warning: " << path << ":" << lineNo << ": ignoring '" << keyword << "'" << std::endl;
+        }
+    }
+    std::cout << "Scene loaded: " << scene.meshes.size() << " meshes, " << scene.instances.size()
+              << " instances, " << scene.totalVertices() << " projected vertices per frame." << std::endl;
+    return !scene.instances.empty();
+}
+
+// -----------------------------------------------------------------------------
+class SceneProjector {
+public:
+    // Vertices per work item; small enough to balance a handful of big meshes
+    // across threads, large enough to amortize the scheduling.
+    static constexpr int kChunkVertices = 4096;
+    // Points closer than this (camera z) are treated as behind the camera.
+    static constexpr double kMinDepth = 1e-6;
+
+    // Frustum culling is on by default but needs the image size in project().
+    // The side planes pass through the image border undistorted with the
+    // calibration (see updateFrustum), pushed out by paddingPx pixels so
+    // lines drawn just outside the image still reach it.
+    void setCulling(bool enabled, double paddingPx = 8.0) {
+        culling_ = enabled;
+        cullPadding_ = std::max(0.0, paddingPx);
+        frustumKey_.fill(0.0);
+    }
+    bool culling() const { return culling_; }
+
+    // Triangles kept by the last project(); all of them without culling.
+    size_t visibleTriangles() const { return visibleTriangles_; }
+    size_t totalTriangles() const { return totalTriangles_; }
+
+    // Projects every instance for the board pose (rvec, tvec). Uses the
+    // pinhole model with up to 5 distortion coefficients (k1 k2 p1 p2 k3),
+    // which is what main.cpp calibrates. Points behind the camera are set to
+    // NaN and their faces are skipped when drawing. With a non-empty
+    // imageSize and culling on, vertices used only by culled triangles are
+    // not updated.
+    void project(const Scene& scene, const cv::Mat& rvec, const cv::Mat& tvec,
+                 const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs,
+                 cv::Size imageSize = cv::Size()) {
+        cv::Matx33d Rb;
+        cv::Rodrigues(rvec, Rb);
+        cv::Vec3d tb;
+        cv::Mat t64;
+        tvec.convertTo(t64, CV_64F);
+        for (int i = 0; i < 3; i++)
+            tb[i] = t64.at<double>(i);
+        cv::Mat K, D;
+        cameraMatrix.convertTo(K, CV_64F);
+        distCoeffs.convertTo(D, CV_64F);
+        Intrinsics intr;
+        intr.fx = K.at<double>(0, 0); intr.fy = K.at<double>(1, 1);
+        intr.cx = K.at<double>(0, 2); intr.cy = K.at<double>(1, 2);
+        double d[5] = {0, 0, 0, 0, 0};
+        for (int i = 0; i < 5 && i < (int)D.total(); i++)
+            d[i] = D.at<double>(i);
+        intr.k1 = d[0]; intr.k2 = d[1]; intr.p1 = d[2]; intr.p2 = d[3]; intr.k3 = d[4];
+
+        // Frustum in camera coordinates: the undistorted image border and
+        // the near limit. Inside is n . X + d >= 0.
+        const bool cull = culling_ && imageSize.area() > 0;
+        CullPlane frustum[5];
+        if (cull) {
+            updateFrustum(K, D, imageSize);
+            const cv::Vec4d &f = frustumBounds_;
+            frustum[0] = CullPlane{cv::Vec3d(1, 0, -f[0]), 0};      // X / Z >= xmin
+            frustum[1] = CullPlane{cv::Vec3d(-1, 0, f[1]), 0};      // X / Z <= xmax
+            frustum[2] = CullPlane{cv::Vec3d(0, 1, -f[2]), 0};      // Y / Z >= ymin
+            frustum[3] = CullPlane{cv::Vec3d(0, -1, f[3]), 0};      // Y / Z <= ymax
+            frustum[4] = CullPlane{cv::Vec3d(0, 0, 1), -kMinDepth}; // Z >= kMinDepth
+        }
+
+        // Per-instance camera transform: X_cam = Rb * (s * Rz * X + t_i) + tb.
+        transforms_.resize(scene.instances.size());
+        offsets_.resize(scene.instances.size());
+        visibleLeaves_.resize(scene.instances.size());
+        culled_.assign(scene.instances.size(), 0);
+        chunks_.clear();
+        indices_.clear();
+        visibleTriangles_ = totalTriangles_ = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < scene.instances.size(); i++) {
+            const SceneInstance &inst = scene.instances[i];
+            double a = inst.rotationDeg * CV_PI / 180.0;
+            cv::Matx33d Rz(std::cos(a), -std::sin(a), 0,
+                           std::sin(a),  std::cos(a), 0,
+                           0, 0, 1);
+            cv::Matx33d A = Rb * Rz * (double)inst.scale;
+            cv::Vec3d ti(inst.translation.x, inst.translation.y, inst.translation.z);
+            cv::Vec3d b = Rb * ti + tb;
+            Transform &T = transforms_[i];
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++)
+                    T.m[r][c] = A(r, c);
+                T.m[r][3] = b[r];
+            }
+            offsets_[i] = total;
+            const SceneMesh &mesh = scene.meshes[inst.mesh];
+            const int n = (int)mesh.vertices.size();
+            total += n;
+            totalTriangles_ += mesh.faces.size();
+            if (cull && cullInstance(mesh, A, b, frustum, i))
+                continue;
+            visibleTriangles_ += mesh.faces.size();
+            for (int begin = 0; begin < n; begin += kChunkVertices)
+                chunks_.push_back(Chunk{(int)i, begin, std::min(n, begin + kChunkVertices), false});
+        }
+        projected_.resize(total);
+
+        cv::parallel_for_(cv::Range(0, (int)chunks_.size()), [&](const cv::Range& range) {
+            for (int c = range.start; c < range.end; c++) {
+                const Chunk &chunk = chunks_[c];
+                const SceneInstance &inst = scene.instances[chunk.instance];
+                const cv::Point3f* src = scene.meshes[inst.mesh].vertices.data();
+                cv::Point2f* dst = projected_.data() + offsets_[chunk.instance];
+                if (chunk.indexed)
+                    projectIndexed(transforms_[chunk.instance], intr, src, dst, indices_.data(), chunk.begin, chunk.end);
+                else
+                    projectRange(transforms_[chunk.instance], intr, src, dst, chunk.begin, chunk.end);
+            }
+        });
+    }
+
+    // Projected vertices of instance i (valid after project()).
+    const cv::Point2f* instancePoints(size_t i) const { return projected_.data() + offsets_[i]; }
+    const std::vector<cv::Point2f>& points() const { return projected_; }
+
+    // Wireframe of every instance; faceStride > 1 draws every n-th face only.
+    // Culled instances draw the faces of their visible leaves, with the same
+    // stride rule so the two paths pick the same faces. Returns the rectangle
+    // drawn into (unclipped, see drawnBounds).
+    cv::Rect draw(cv::Mat& frame, const Scene& scene, const cv::Scalar& color, int thickness,
+                  int faceStride = 1) const {
+        faceStride = std::max(1, faceStride);
+        cv::Point2f lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+        for (size_t i = 0; i < scene.instances.size(); i++) {
+            const SceneMesh &mesh = scene.meshes[scene.instances[i].mesh];
+            const cv::Point2f* pts = instancePoints(i);
+            const int n = (int)mesh.vertices.size();
+            if (i < culled_.size() && culled_[i]) {
+                const std::vector<int> &triangles = mesh.bvh.triangles();
+                for (int leaf : visibleLeaves_[i]) {
+                    const MeshBVH::Node &nd = mesh.bvh.node(leaf);
+                    for (int t = nd.firstTriangle; t < nd.firstTriangle + nd.numTriangles; t++)
+                        if (triangles[t] % faceStride == 0)
+                            drawFace(frame, mesh.faces[triangles[t]], pts, n, color, thickness, lo, hi);
+                }
+                continue;
+            }
+            for (size_t k = 0; k < mesh.faces.size(); k += faceStride)
+                drawFace(frame, mesh.faces[k], pts, n, color, thickness, lo, hi);
+        }
+        return drawnBounds(lo, hi, thickness);
+    }
+
+private:
+    struct Transform { double m[3][4]; };
+    struct Intrinsics { double fx, fy, cx, cy, k1, k2, p1, p2, k3; };
+    // [begin, end) is a vertex range, or a range of indices_ when indexed.
+    struct Chunk { int instance, begin, end; bool indexed; };
+
+    // Bounds (xmin, xmax, ymin, ymax) of x = X / Z, y = Y / Z over every
+    // point that projects into the image. The image border is sampled,
+    // undistorted with enough iterations to converge under strong
+    // distortion, and the extremes are padded by cullPadding_ pixels.
+    // Computed again only when the intrinsics or the image size change.
+    // Where the distortion polynomial turns back (far outside the image for
+    // a sensible calibration), points beyond these bounds can project into
+    // the image again; culling drops such folded-over geometry.
+    void updateFrustum(const cv::Mat& K, const cv::Mat& D, cv::Size imageSize) {
+        std::array<double, 16> key;
+        key.fill(0.0);
+        key[0] = imageSize.width;
+        key[1] = imageSize.height;
+        for (int i = 0; i < 9; i++)
+            key[2 + i] = K.at<double>(i / 3, i % 3);
+        for (int i = 0; i < 5 && i < (int)D.total(); i++)
+            key[11 + i] = D.at<double>(i);
+        if (key == frustumKey_)
+            return;
+        frustumKey_ = key;
+
+        const int kSamples = 16; // per image side
+        const float w = (float)(imageSize.width - 1), h = (float)(imageSize.height - 1);
+        std::vector<cv::Point2f> border, normalized;
+        for (int i = 0; i <= kSamples; i++) {
+            const float a = (float)i / kSamples;
+            border.push_back(cv::Point2f(a * w, 0));
+            border.push_back(cv::Point2f(a * w, h));
+            border.push_back(cv::Point2f(0, a * h));
+            border.push_back(cv::Point2f(w, a * h));
+        }
+        cv::undistortPoints(border, normalized, K, D, cv::noArray(), cv::noArray(),
+                            cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 100, 1e-9));
+        cv::Vec4d &f = frustumBounds_;
+        f = cv::Vec4d(DBL_MAX, -DBL_MAX, DBL_MAX, -DBL_MAX);
+        for (const cv::Point2f &p : normalized) {
+            f[0] = std::min(f[0], (double)p.x); f[1] = std::max(f[1], (double)p.x);
+            f[2] = std::min(f[2], (double)p.y); f[3] = std::max(f[3], (double)p.y);
+        }
+        const double px = cullPadding_ / K.at<double>(0, 0), py = cullPadding_ / K.at<double>(1, 1);
+        f += cv::Vec4d(-px, px, -py, py);
+    }
+
+    // Moves the frustum into the mesh space of one instance (X_cam = A X + b)
+    // and culls its BVH. Returns false when the whole mesh is inside, so the
+    // caller projects it as one contiguous range. Otherwise queues the
+    // distinct vertices of the visible leaves as indexed chunks.
+    bool cullInstance(const SceneMesh& mesh, const cv::Matx33d& A, const cv::Vec3d& b,
+                      const CullPlane* frustum, size_t i) {
+        CullPlane local[5];
+        for (int p = 0; p < 5; p++)
+            local[p] = CullPlane{A.t() * frustum[p].n, frustum[p].n.dot(b) + frustum[p].d};
+        std::vector<int> &leaves = visibleLeaves_[i];
+        leaves.clear();
+        const int kept = mesh.bvh.cull(local, 5, leaves);
+        if (kept == (int)mesh.bvh.numTriangles())
+            return false;
+        culled_[i] = 1;
+        visibleTriangles_ += kept;
+
+        // A vertex shared by several visible leaves is queued once, so no
+        // two chunks write the same output.
+        if (stamp_.size() < mesh.vertices.size())
+            stamp_.resize(mesh.vertices.size(), 0);
+        if (++stampId_ == 0) {
+            std::fill(stamp_.begin(), stamp_.end(), 0u);
+            stampId_ = 1;
+        }
+        const int first = (int)indices_.size();
+        const std::vector<int> &leafVertices = mesh.bvh.leafVertices();
+        for (int leaf : leaves) {
+            const MeshBVH::Node &nd = mesh.bvh.node(leaf);
+            for (int k = nd.firstVertex; k < nd.firstVertex + nd.numVertices; k++) {
+                const int v = leafVertices[k];
+                if (stamp_[v] != stampId_) {
+                    stamp_[v] = stampId_;
+                    indices_.push_back(v);
+                }
+            }
+        }
+        const int last = (int)indices_.size();
+        for (int begin = first; begin < last; begin += kChunkVertices)
+            chunks_.push_back(Chunk{(int)i, begin, std::min(last, begin + kChunkVertices), true});
+        return true;
+    }
+
+    static void drawFace(cv::Mat& frame, const cv::Vec3i& f, const cv::Point2f* pts, int n,
+                         const cv::Scalar& color, int thickness, cv::Point2f& lo, cv::Point2f& hi) {
+        if (f[0] < 0 || f[0] >= n || f[1] < 0 || f[1] >= n || f[2] < 0 || f[2] >= n)
+            return;
+        const cv::Point2f &p1 = pts[f[0]], &p2 = pts[f[1]], &p3 = pts[f[2]];
+        if (std::isnan(p1.x) || std::isnan(p2.x) || std::isnan(p3.x))
+            return;
+        cv::line(frame, p1, p2, color, thickness);
+        cv::line(frame, p2, p3, color, thickness);
+        cv::line(frame, p3, p1, color, thickness);
+        growBounds(lo, hi, p1);
+        growBounds(lo, hi, p2);
+        growBounds(lo, hi, p3);
+    }
+
+    static inline cv::Point2f projectPoint(const Transform& T, const Intrinsics& in, const cv::Point3f& P) {
+        const double X = P.x, Y = P.y, Z = P.z;
+        const double x = T.m[0][0] * X + T.m[0][1] * Y + T.m[0][2] * Z + T.m[0][3];
+        const double y = T.m[1][0] * X + T.m[1][1] * Y + T.m[1][2] * Z + T.m[1][3];
+        const double z = T.m[2][0] * X + T.m[2][1] * Y + T.m[2][2] * Z + T.m[2][3];
+        if (z <= kMinDepth) {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            return cv::Point2f(nan, nan);
+        }
+        const double iz = 1.0 / z;
+        const double xn = x * iz, yn = y * iz;
+        const double r2 = xn * xn + yn * yn;
+        const double radial = 1.0 + r2 * (in.k1 + r2 * (in.k2 + r2 * in.k3));
+        const double xd = xn * radial + 2.0 * in.p1 * xn * yn + in.p2 * (r2 + 2.0 * xn * xn);
+        const double yd = yn * radial + in.p1 * (r2 + 2.0 * yn * yn) + 2.0 * in.p2 * xn * yn;
+        return cv::Point2f((float)(in.fx * xd + in.cx), (float)(in.fy * yd + in.cy));
+    }
+
+    // Tight loop over contiguous vertices, no branches besides the z test,
+    // so the compiler can vectorize it.
+    static void projectRange(const Transform& T, const Intrinsics& in, const cv::Point3f* src,
+                             cv::Point2f* dst, int begin, int end) {
+        for (int v = begin; v < end; v++)
+            dst[v] = projectPoint(T, in, src[v]);
+    }
+
+    // Same for the vertices listed in index[begin, end) of a culled instance.
+    static void projectIndexed(const Transform& T, const Intrinsics& in, const cv::Point3f* src,
+                               cv::Point2f* dst, const int* index, int begin, int end) {
+        for (int k = begin; k < end; k++)
+            dst[index[k]] = projectPoint(T, in, src[index[k]]);
+    }
+
+    bool culling_ = true;
+    double cullPadding_ = 8.0;
+    std::array<double, 16> frustumKey_{};  // image size, K and D frustumBounds_ is for
+    cv::Vec4d frustumBounds_;
+    size_t visibleTriangles_ = 0, totalTriangles_ = 0;
+
+    std::vector<Transform> transforms_;
+    std::vector<size_t> offsets_;
+    std::vector<Chunk> chunks_;
+    std::vector<cv::Point2f> projected_;
+
+    // Culling state of the last project().
+    std::vector<std::vector<int>> visibleLeaves_; // per instance
+    std::vector<char> culled_;                    // per instance: draw visibleLeaves_ only
+    std::vector<int> indices_;                    // vertices to project for culled instances
+    std::vector<unsigned> stamp_;                 // dedupes shared vertices while gathering
+    unsigned stampId_ = 0;
+};
@@ -0,0 +1,96 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Synthetic checkerboard images with exact corner positions, for the
+// detector and refinement benchmarks.
+//
+// The board is warped with a random homography at 4x resolution and area
+// averaged down to the output size. This gives anti-aliased edges with exact
+// ground truth. Gaussian noise is added at the end.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Renders a board with patternSize inner corners whose squares are roughly
+// 'squarePx' pixels wide, at a random position, rotation (up to
+// maxAngle radians) and tilt. 'truth' receives the inner corners row-major,
+// starting next to the dark board-corner square.
+inline void renderSyntheticBoard(cv::Size patternSize, double squarePx, double noiseSigma, double maxAngle,
+                                 std::mt19937& rng, cv::Mat& gray, std::vector<cv::Point2f>& truth,
+                                 cv::Size imageSize = cv::Size(640, 480)) {
+    const int k = 4;                       // supersampling factor
+    const int S = 100;                     // canonical square size
+    const int cols = patternSize.width + 1, rows = patternSize.height + 1;
+
+    // Canonical board with a white margin of one square.
+    cv::Mat board((rows + 2) * S, (cols + 2) * S, CV_8UC1, cv::Scalar(255));
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < cols; c++)
+            if ((r + c) % 2 == 0)
+                cv::rectangle(board, cv::Rect((c + 1) * S, (r + 1) * S, S, S), cv::Scalar(0), cv::FILLED);
+
+    std::uniform_real_distribution<double> U(-1.0, 1.0);
+    const double w = squarePx * (cols + 2), h = squarePx * (rows + 2);
+    const double angle = U(rng) * maxAngle;
+    const double cx = imageSize.width / 2.0 + U(rng) * std::max(0.0, imageSize.width - w) * 0.3;
+    const double cy = imageSize.height / 2.0 + U(rng) * std::max(0.0, imageSize.height - h) * 0.3;
+    std::vector<cv::Point2f> src = {
+        cv::Point2f(-0.5f, -0.5f), cv::Point2f(board.cols - 0.5f, -0.5f),
+        cv::Point2f(board.cols - 0.5f, board.rows - 0.5f), cv::Point2f(-0.5f, board.rows - 0.5f)};
+    std::vector<cv::Point2f> dstHi;
+    const double offs[4][2] = {{-0.5, -0.5}, {0.5, -0.5}, {0.5, 0.5}, {-0.5, 0.5}};
+    for (int i = 0; i < 4; i++) {
+        double x = offs[i][0] * w * (1.0 + 0.15 * U(rng)), y = offs[i][1] * h * (1.0 + 0.15 * U(rng));
+        double xr = std::cos(angle) * x - std::sin(angle) * y + cx;
+        double yr = std::sin(angle) * x + std::cos(angle) * y + cy;
+        // Output pixel centre x maps to (x + 0.5) * k - 0.5 in the big image.
+        dstHi.push_back(cv::Point2f((float)((xr + 0.5) * k - 0.5), (float)((yr + 0.5) * k - 0.5)));
+    }
+    cv::Mat H = cv::getPerspectiveTransform(src, dstHi);
+
+    cv::Mat hi, lo, lo32;
+    cv::warpPerspective(board, hi, H, cv::Size(imageSize.width * k, imageSize.height * k), cv::INTER_LINEAR,
+                        cv::BORDER_CONSTANT, cv::Scalar(128));
+    cv::resize(hi, lo, imageSize, 0, 0, cv::INTER_AREA);
+    cv::Mat noise(lo.size(), CV_32F);
+    cv::randn(noise, 0, noiseSigma);
+    lo.convertTo(lo32, CV_32F);
+    lo32 += noise;
+    lo32.convertTo(gray, CV_8U);
+
+    // Inner corners sit on square boundaries (pixel edges at -0.5).
+    std::vector<cv::Point2f> canon, hiTruth;
+    for (int r = 0; r < patternSize.height; r++)
+        for (int c = 0; c < patternSize.width; c++)
+            canon.push_back(cv::Point2f((c + 2) * S - 0.5f, (r + 2) * S - 0.5f));
+    cv::perspectiveTransform(canon, hiTruth, H);
+    truth.clear();
+    for (const auto &p : hiTruth)
+        truth.push_back(cv::Point2f((p.x + 0.5f) / k - 0.5f, (p.y + 0.5f) / k - 0.5f));
+}
+
+// -----------------------------------------------------------------------------
+// Largest distance between detected corners and the nearest ground truth
+// corner, i.e. how far the detection is from the board regardless of order.
+inline double unorderedMaxError(const std::vector<cv::Point2f>& found, const std::vector<cv::Point2f>& truth) {
+    double worst = 0;
+    for (const auto &t : truth) {
+        double best = 1e9;
+        for (const auto &f : found)
+            best = std::min(best, (double)cv::norm(f - t));
+        worst = std::max(worst, best);
+    }
+    return worst;
+}
@@ -0,0 +1,313 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Compact binary log of per-frame detection results (.artrj).
+//
+// Layout (little-endian, every block 8-byte aligned):
+//   TrajectoryLogHeader                        128 bytes, intrinsics included
+//   record 0 .. N-1                            TrajectoryRecord + cornerCount * 2 floats
+//   uint64 offsets[N]                          written on close, one per record
+// The header holds the record count and the offset of the index, so a reader
+// that maps the file can jump to any frame in O(1). If the recorder died
+// before writing the index, the reader rebuilds it with one linear scan.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kTrajectoryMagic[8] = {'A', 'R', 'T', 'R', 'J', 'L', 'O', 'G'};
+static const uint32_t kTrajectoryVersion = 1;
+
+struct TrajectoryLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t recordCount;   // 0 until the index is written
+    uint64_t indexOffset;   // 0 until the index is written
+    int64_t createdNs;
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    double camera[4];       // fx, fy, cx, cy
+    double dist[5];         // k1, k2, p1, p2, k3
+    uint64_t reserved;
+};
+
+// Tracking state values match PoseShmState / TrackState.
+struct TrajectoryRecord {
+    int64_t timestampNs;    // capture time
+    uint32_t frameIndex;    // frame number in the source video
+    int16_t state;          // 0 lost, 1 detected, 2 tracked
+    uint16_t cornerCount;   // followed by cornerCount (x, y) float pairs
+    float rvec[3];
+    float tvec[3];
+};
+
+static_assert(sizeof(TrajectoryLogHeader) == 128, "unexpected trajectory header size");
+static_assert(sizeof(TrajectoryRecord) == 40, "unexpected trajectory record size");
+
+inline size_t trajectoryRecordBytes(uint16_t cornerCount) {
+    return sizeof(TrajectoryRecord) + sizeof(float) * 2 * cornerCount;
+}
+
+// -----------------------------------------------------------------------------
+// Appends records through a large stdio buffer; the index is kept in memory
+// (8 bytes per frame) and written once on close().
+class TrajectoryLogWriter {
+public:
+    TrajectoryLogWriter() {}
+    ~TrajectoryLogWriter() { close(); }
+    TrajectoryLogWriter(const TrajectoryLogWriter&) = delete;
+    TrajectoryLogWriter& operator=(const TrajectoryLogWriter&) = delete;
+
+    bool open(const std::string& path, uint32_t frameWidth, uint32_t frameHeight,
+              const double camera[4], const double dist[5], int64_t createdNs) {
+        close();
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            std::cerr << "Error: Could not open trajectory log for writing: " << path << std::endl;
+            return false;
+        }
+        std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+
+        std::memset(&header_, 0, sizeof(header_));
+        std::memcpy(header_.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic));
+        header_.version = kTrajectoryVersion;
+        header_.headerSize = sizeof(TrajectoryLogHeader);
+        header_.createdNs = createdNs;
+        header_.frameWidth = frameWidth;
+        header_.frameHeight = frameHeight;
+        for (int i = 0; i < 4; i++)
+            header_.camera[i] = camera ? camera[i] : 0.0;
+        for (int i = 0; i < 5; i++)
+            header_.dist[i] = dist ? dist[i] : 0.0;
+        offsets_.clear();
+        offset_ = sizeof(header_);
+        return std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+
+    // 'corners' holds cornerCount (x, y) pairs and may be null.
+    void append(int64_t timestampNs, uint32_t frameIndex, int16_t state,
+                const float rvec[3], const float tvec[3], const float* corners, int cornerCount) {
+        if (!file_)
+            return;
+        TrajectoryRecord r;
+        r.timestampNs = timestampNs;
+        r.frameIndex = frameIndex;
+        r.state = state;
+        r.cornerCount = (uint16_t)(corners && cornerCount > 0 ? cornerCount : 0);
+        for (int i = 0; i < 3; i++) {
+            r.rvec[i] = rvec ? rvec[i] : 0.0f;
+            r.tvec[i] = tvec ? tvec[i] : 0.0f;
+        }
+        std::fwrite(&r, sizeof(r), 1, file_);
+        if (r.cornerCount > 0)
+            std::fwrite(corners, sizeof(float) * 2, r.cornerCount, file_);
+        offsets_.push_back(offset_);
+        offset_ += trajectoryRecordBytes(r.cornerCount);
+    }
+
+    uint64_t recordCount() const { return offsets_.size(); }
+
+    // Writes the index and patches the header. Safe to call twice.
+    void close() {
+        if (!file_)
+            return;
+        if (!offsets_.empty())
+            std::fwrite(offsets_.data(), sizeof(uint64_t), offsets_.size(), file_);
+        header_.recordCount = offsets_.size();
+        header_.indexOffset = offset_;
+        std::fseek(file_, 0, SEEK_SET);
+        std::fwrite(&header_, sizeof(header_), 1, file_);
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+private:
+    FILE* file_ = nullptr;
+    TrajectoryLogHeader header_;
+    std::vector<uint64_t> offsets_;
+    uint64_t offset_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Memory-maps a log; record(i) is a pointer into the mapping, no copies.
+class TrajectoryLogReader {
+public:
+    TrajectoryLogReader() {}
+    ~TrajectoryLogReader() { close(); }
+    TrajectoryLogReader(const TrajectoryLogReader&) = delete;
+    TrajectoryLogReader& operator=(const TrajectoryLogReader&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open trajectory log: " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TrajectoryLogHeader)) {
+            std::cerr << "Error: " << path << " is too small to be a trajectory log." << std::endl;
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            std::cerr << "Error: Could not map trajectory log: " << path << std::endl;
+            return false;
+        }
+        base_ = static_cast<const char*>(base);
+        bytes_ = (size_t)st.st_size;
+        header_ = reinterpret_cast<const TrajectoryLogHeader*>(base_);
+        if (std::memcmp(header_->magic, kTrajectoryMagic, sizeof(kTrajectoryMagic)) != 0 ||
+            header_->version != kTrajectoryVersion || header_->headerSize != sizeof(TrajectoryLogHeader)) {
+            std::cerr << "Error: " << path << " is not a compatible trajectory log." << std::endl;
+            close();
+            return false;
+        }
+
+        if (indexValid()) {
+            index_ = reinterpret_cast<const uint64_t*>(base_ + header_->indexOffset);
+            count_ = header_->recordCount;
+        } else {
+            // Recorder did not finish, or the index is damaged: rebuild it
+            // from the records.
+            std::cerr << "Warning: " << path << " has no usable index, scanning records." << std::endl;
+            // Records end where the index starts, if the header says where.
+            const uint64_t at = header_->indexOffset;
+            const uint64_t end = (at >= sizeof(TrajectoryLogHeader) && at <= bytes_) ? at : bytes_;
+            uint64_t offset = sizeof(TrajectoryLogHeader);
+            while (offset + sizeof(TrajectoryRecord) <= end) {
+                const TrajectoryRecord* r = reinterpret_cast<const TrajectoryRecord*>(base_ + offset);
+                size_t size = trajectoryRecordBytes(r->cornerCount);
+                if (offset + size > end || r->state < 0 || r->state > 2)
+                    break; // truncated or garbage tail
+                rebuiltIndex_.push_back(offset);
+                offset += size;
+            }
+            index_ = rebuiltIndex_.data();
+            count_ = rebuiltIndex_.size();
+        }
+        return true;
+    }
+
+    void close() {
+        if (!base_)
+            return;
+        munmap(const_cast<char*>(base_), bytes_);
+        base_ = nullptr;
+        index_ = nullptr;
+        count_ = 0;
+        rebuiltIndex_.clear();
+    }
+
+    uint64_t size() const { return count_; }
+    const TrajectoryLogHeader& header() const { return *header_; }
+
+    // O(1) access to record i (i < size()).
+    const TrajectoryRecord& record(uint64_t i) const {
+        return *reinterpret_cast<const TrajectoryRecord*>(base_ + index_[i]);
+    }
+
+    // Corner (x, y) pairs of record i, cornerCount of them.
+    const float* corners(uint64_t i) const {
+        return reinterpret_cast<const float*>(base_ + index_[i] + sizeof(TrajectoryRecord));
+    }
+
+    // Hint the kernel about the access pattern (sequential re-render vs seeking).
+    void adviseSequential(bool sequential) const {
+        if (base_)
+            madvise(const_cast<char*>(base_), bytes_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+private:
+    // The on-disk index is only used if every offset points at a whole,
+    // 8-byte aligned record between the header and the index, in increasing
+    // order.
+    bool indexValid() const {
+        const uint64_t n = header_->recordCount, at = header_->indexOffset;
+        if (at == 0 || at % 8 != 0 || at < sizeof(TrajectoryLogHeader) || at > bytes_ ||
+            n > (bytes_ - at) / sizeof(uint64_t))
+            return false;
+        const uint64_t* index = reinterpret_cast<const uint64_t*>(base_ + at);
+        uint64_t minOffset = sizeof(TrajectoryLogHeader);
+        for (uint64_t i = 0; i < n; i++) {
+            const uint64_t offset = index[i];
+            if (offset < minOffset || offset % 8 != 0 || offset > at - sizeof(TrajectoryRecord))
+                return false;
+            const TrajectoryRecord* r = reinterpret_cast<const TrajectoryRecord*>(base_ + offset);
+            if (offset + trajectoryRecordBytes(r->cornerCount) > at)
+                return false;
+            minOffset = offset + trajectoryRecordBytes(r->cornerCount);
+        }
+        return true;
+    }
+
+    const char* base_ = nullptr;
+    size_t bytes_ = 0;
+    const TrajectoryLogHeader* header_ = nullptr;
+    const uint64_t* index_ = nullptr;
+    uint64_t count_ = 0;
+    std::vector<uint64_t> rebuiltIndex_;
+};
+
+#ifdef CV_VERSION
+// -----------------------------------------------------------------------------
+// Convenience for the OpenCV demos.
+inline bool openTrajectoryLog(TrajectoryLogWriter& writer, const std::string& path, cv::Size frameSize,
+                              const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, int64_t createdNs) {
+    cv::Mat K, D;
+    cameraMatrix.convertTo(K, CV_64F);
+    distCoeffs.convertTo(D, CV_64F);
+    double camera[4] = {K.at<double>(0, 0), K.at<double>(1, 1), K.at<double>(0, 2), K.at<double>(1, 2)};
+    double dist[5] = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 5 && i < (int)D.total(); i++)
+        dist[i] = D.at<double>(i);
+    return writer.open(path, (uint32_t)frameSize.width, (uint32_t)frameSize.height, camera, dist, createdNs);
+}
+
+inline void logFrame(TrajectoryLogWriter& writer, int64_t timestampNs, uint32_t frameIndex, int16_t state,
+                     const cv::Mat& rvec, const cv::Mat& tvec, const std::vector<cv::Point2f>& corners) {
+    if (!writer.isOpen())
+        return;
+    float r[3] = {0, 0, 0}, t[3] = {0, 0, 0};
+    if (!rvec.empty() && !tvec.empty()) {
+        cv::Mat r64, t64;
+        rvec.convertTo(r64, CV_64F);
+        tvec.convertTo(t64, CV_64F);
+        for (int i = 0; i < 3; i++) {
+            r[i] = (float)r64.at<double>(i);
+            t[i] = (float)t64.at<double>(i);
+        }
+    }
+    writer.append(timestampNs, frameIndex, state, r, t,
+                  corners.empty() ? nullptr : &corners[0].x, (int)corners.size());
+}
+
+// Camera matrix and distortion coefficients stored in the log header.
+inline void trajectoryIntrinsics(const TrajectoryLogHeader& h, cv::Mat& cameraMatrix, cv::Mat& distCoeffs) {
+    cameraMatrix = (cv::Mat_<double>(3, 3) << h.camera[0], 0, h.camera[2],
+                                              0, h.camera[1], h.camera[3],
+                                              0, 0, 1);
+    distCoeffs = (cv::Mat_<double>(5, 1) << h.dist[0], h.dist[1], h.dist[2], h.dist[3], h.dist[4]);
+}
+#endif
@@ -0,0 +1,165 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Small work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own tasks at the back
+// (LIFO, keeps a stream on the core that has its data in cache) and idle
+// workers steal from the front of other deques (FIFO, oldest work first).
+// A task that resubmits itself uses requeue(), which puts the continuation
+// at the front, so it takes turns with the other tasks in the deque.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned numThreads = std::thread::hardware_concurrency()) {
+        if (numThreads == 0)
+            numThreads = 1;
+        for (unsigned i = 0; i < numThreads; i++)
+            queues_.emplace_back(new WorkerQueue());
+        for (unsigned i = 0; i < numThreads; i++)
+            threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stopping_ = true;
+        }
+        sleepCv_.notify_all();
+        for (auto &t : threads_)
+            t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return (unsigned)threads_.size(); }
+
+    // Queues a task. Called from a worker it goes to that worker's own
+    // deque; from outside the pool the queues are filled round-robin.
+    void submit(Task task) { push(std::move(task), false); }
+
+    // Queues the continuation of the running task behind everything else in
+    // this worker's deque. popLocal takes the newest task, so a continuation
+    // pushed by submit() would run again at once and starve the streams
+    // queued before it. From outside the pool it is the same as submit().
+    void requeue(Task task) { push(std::move(task), currentPool() == this); }
+
+    // Blocks until every submitted task (including tasks submitted by tasks)
+    // has finished.
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        idleCv_.wait(lock, [this] { return pending_.load() == 0; });
+    }
+
+    // Number of tasks that were taken from another worker's deque.
+    long steals() const { return steals_.load(); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static WorkStealingPool*& currentPool() { static thread_local WorkStealingPool* pool = nullptr; return pool; }
+    static unsigned& currentIndex() { static thread_local unsigned index = 0; return index; }
+
+    void push(Task task, bool front) {
+        unsigned target = (currentPool() == this) ? currentIndex()
+                                                  : nextQueue_.fetch_add(1) % (unsigned)queues_.size();
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+            if (front)
+                queues_[target]->tasks.push_front(std::move(task));
+            else
+                queues_[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            queued_++;
+        }
+        sleepCv_.notify_one();
+    }
+
+    bool popLocal(unsigned self, Task& task) {
+        WorkerQueue &q = *queues_[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty())
+            return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned self, Task& task) {
+        const unsigned n = (unsigned)queues_.size();
+        for (unsigned k = 1; k < n; k++) {
+            WorkerQueue &q = *queues_[(self + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                steals_.fetch_add(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned self) {
+        currentPool() = this;
+        currentIndex() = self;
+        while (true) {
+            Task task;
+            if (popLocal(self, task) || steal(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex_);
+                    queued_--;
+                }
+                task();
+                if (pending_.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(sleepMutex_);
+                    idleCv_.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            sleepCv_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+            if (stopping_ && queued_ == 0)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    std::condition_variable idleCv_;
+    long queued_ = 0;       // tasks sitting in any deque, guarded by sleepMutex_
+    bool stopping_ = false; // guarded by sleepMutex_
+
+    std::atomic<long> pending_{0}; // queued or running
+    std::atomic<unsigned> nextQueue_{0};
+    std::atomic<long> steals_{0};
+};
@@ -0,0 +1,194 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Detection rate, accuracy and time of XCornerDetector<9, 6>
+// (xcorner_detector.hpp) against findChessboardCorners with and without
+// CALIB_CB_FAST_CHECK.
+//
+// Synthetic boards (synthetic_board.hpp) at several square sizes and any
+// rotation, plus frames without a board to time rejection and count false
+// positives. With --video the same comparison runs on real frames: there is
+// no ground truth there, so only detection rate and time are reported.
+//
+// Usage: xcornerbench [--samples n] [--noise sigma] [--video file]
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "corner_refine.hpp"
+#include "synthetic_board.hpp"
+#include "xcorner_detector.hpp"
+
+using namespace cv;
+using namespace std;
+
+struct Detector {
+    string name;
+    function<bool(const Mat&, vector<Point2f>&)> detect;
+    bool fixedOrder = false; // corners must start at the truth's first corner
+    long found = 0, frames = 0, wrong = 0;
+    double millis = 0, sqErr = 0;
+    long corners = 0;
+
+    void reset() { found = frames = wrong = corners = 0; millis = sqErr = 0; }
+};
+
+static void printHeader() {
+    cout << left << setw(30) << "detector" << right << setw(10) << "found" << setw(10) << "wrong"
+         << setw(12) << "RMS px" << setw(12) << "ms/frame" << endl;
+}
+
+static void printRow(const Detector& d, bool withTruth) {
+    cout << left << setw(30) << d.name << right << setw(6) << d.found << "/" << setw(3) << d.frames;
+    if (withTruth)
+        cout << setw(10) << d.wrong << setw(12) << fixed << setprecision(4)
+             << (d.corners ? sqrt(d.sqErr / d.corners) : 0.0);
+    else
+        cout << setw(10) << "-" << setw(12) << "-";
+    cout << setw(12) << fixed << setprecision(2) << d.millis / max(1L, d.frames) << endl;
+}
+
+// Runs one detector on one frame and scores it against 'truth' if given.
+static void runOne(Detector& d, const Mat& gray, const vector<Point2f>* truth, bool boardPresent) {
+    vector<Point2f> corners;
+    auto t0 = chrono::steady_clock::now();
+    bool ok = d.detect(gray, corners);
+    d.millis += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    d.frames++;
+    if (!ok)
+        return;
+    d.found++;
+    if (!boardPresent || (truth && unorderedMaxError(corners, *truth) > 2.0)) {
+        d.wrong++; // false positive, or a grid that is not the board
+        return;
+    }
+    if (!truth)
+        return;
+    // findChessboardCorners may start at either end, so it is scored in the
+    // better order. A detector with a fixed order is scored as returned: a
+    // reversed board counts as wrong.
+    double forward = 0, backward = 0;
+    const size_t n = truth->size();
+    for (size_t i = 0; i < n; i++) {
+        forward += pow(norm(corners[i] - (*truth)[i]), 2);
+        backward += pow(norm(corners[n - 1 - i] - (*truth)[i]), 2);
+    }
+    if (d.fixedOrder && backward < forward) {
+        d.wrong++;
+        return;
+    }
+    d.sqErr += d.fixedOrder ? forward : min(forward, backward);
+    d.corners += (long)n;
+}
+
+int main(int argc, char** argv)
+{
+    int samples = 50;
+    double noise = 2.0;
+    string video;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--samples") samples = atoi(argv[i + 1]);
+        else if (arg == "--noise") noise = atof(argv[i + 1]);
+        else if (arg == "--video") video = argv[i + 1];
+    }
+
+    const Size patternSize(9, 6);
+    const int baseFlags = CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE;
+    XCornerDetector<9, 6> xcorner;
+
+    // Every detector returns refined corners so the accuracy is comparable.
+    vector<Detector> detectors(3);
+    detectors[0].name = "findChessboardCorners";
+    detectors[0].detect = [&](const Mat& g, vector<Point2f>& c) {
+        if (!findChessboardCorners(g, patternSize, c, baseFlags))
+            return false;
+        refineCorners(g, c, patternSize);
+        return true;
+    };
+    detectors[1].name = "findChessboardCorners FAST";
+    detectors[1].detect = [&](const Mat& g, vector<Point2f>& c) {
+        if (!findChessboardCorners(g, patternSize, c, baseFlags | CALIB_CB_FAST_CHECK))
+            return false;
+        refineCorners(g, c, patternSize);
+        return true;
+    };
+    detectors[2].name = "XCornerDetector<9, 6>";
+    detectors[2].detect = [&](const Mat& g, vector<Point2f>& c) { return xcorner.detect(g, c); };
+    detectors[2].fixedOrder = true;
+
+    mt19937 rng(5330);
+    cout << "Synthetic 9x6 boards, " << samples << " per size, noise sigma " << noise << endl;
+    for (double squarePx : {10.0, 15.0, 25.0, 40.0}) {
+        for (auto &d : detectors)
+            d.reset();
+        for (int s = 0; s < samples; s++) {
+            Mat gray;
+            vector<Point2f> truth;
+            renderSyntheticBoard(patternSize, squarePx, noise, CV_PI, rng, gray, truth);
+            for (auto &d : detectors)
+                runOne(d, gray, &truth, true);
+        }
+        cout << endl << "square ~" << squarePx << " px" << endl;
+        printHeader();
+        for (const auto &d : detectors)
+            printRow(d, true);
+    }
+
+    // No board: smoothed noise at a few scales plus a blank frame.
+    for (auto &d : detectors)
+        d.reset();
+    for (int s = 0; s < samples; s++) {
+        Mat gray(480, 640, CV_8UC1), noiseImage(480, 640, CV_32F);
+        randn(noiseImage, 128, 60);
+        const double blur = 1.0 + (s % 4);
+        GaussianBlur(noiseImage, noiseImage, Size(), blur);
+        noiseImage.convertTo(gray, CV_8U);
+        if (s == 0)
+            gray.setTo(Scalar(128));
+        for (auto &d : detectors)
+            runOne(d, gray, nullptr, false);
+    }
+    cout << endl << "no board (wrong = false positives)" << endl;
+    printHeader();
+    for (const auto &d : detectors)
+        printRow(d, false);
+    for (const auto &d : detectors)
+        if (d.wrong)
+            cout << "  " << d.name << ": " << d.wrong << " false positives" << endl;
+
+    if (!video.empty()) {
+        VideoCapture cap(video);
+        if (!cap.isOpened()) {
+            cerr << "Error: Could not open " << video << endl;
+            return -1;
+        }
+        for (auto &d : detectors)
+            d.reset();
+        Mat frame, gray;
+        while (cap.read(frame)) {
+            cvtColor(frame, gray, COLOR_BGR2GRAY);
+            for (auto &d : detectors)
+                runOne(d, gray, nullptr, true);
+        }
+        cout << endl << video << endl;
+        printHeader();
+        for (const auto &d : detectors)
+            printRow(d, false);
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+Akshaj Raut
+Atharva Nayak
+
+CS 5330 Computer Vision
+Spring 2025
+
+Project 4 - Calibration and Augmented Reality
+*/
+
+// Checkerboard detector specialised for one known board, as an alternative
+// to findChessboardCorners (which thresholds the image, extracts quads and
+// links them for any board size).
+//
+//  1. Saddle response: inner checkerboard corners are saddle points of the
+//     smoothed intensity, where the Hessian determinant is strongly
+//     negative. The response Ixy^2 - Ixx*Iyy comes from OpenCV's SIMD
+//     filters plus one fused per-pixel loop that the compiler vectorizes.
+//  2. Non-maximum suppression with a dilated copy of the response, then a
+//     ring test: the smoothed intensity on a small circle around an
+//     X-corner changes sign exactly four times around its mean.
+//  3. Grid fit: a lattice is grown from a strong seed by predicting each
+//     neighbour from the already placed ones. A board is found only if the
+//     lattice is exactly Cols x Rows and every cell is filled.
+//  4. Ordering: row-major, rows along Cols. The handedness matches the
+//     board object points (j, -i, 0). Where the board has no 180 degree
+//     symmetry (9x6 has none), the corner squares' colours fix which end
+//     comes first, so the order follows the physical board at any rotation.
+//  5. Sub-pixel refinement with refineCorners.
+//
+// The board size is a template parameter, so lattice buffers are fixed-size
+// arrays and the loops have compile-time bounds.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "corner_refine.hpp"
+
+template <int Cols, int Rows>
+class XCornerDetector {
+    static_assert(Cols >= 3 && Rows >= 3, "board needs at least 3x3 inner corners");
+
+public:
+    static constexpr int kCorners = Cols * Rows;
+
+    struct Params {
+        double sigma = 1.5;           // smoothing before the second derivatives
+        int nmsRadius = 3;            // non-maximum suppression half window
+        double relativeThreshold = 0.05; // response threshold, fraction of the maximum
+        float minContrast = 15.0f;    // ring max - min, grey levels
+        int maxSeeds = 8;             // lattice seeds tried before giving up
+    };
+
+    XCornerDetector() = default;
+    explicit XCornerDetector(const Params& params) : params_(params) {}
+
+    static cv::Size patternSize() { return cv::Size(Cols, Rows); }
+    void setRefineParams(const CornerRefineParams& refine) { refine_ = refine; }
+    int lastCandidates() const { return (int)candidates_.size(); }
+
+    // Finds the board in an 8-bit grey image. On success 'corners' holds
+    // Cols * Rows refined corners in row-major order.
+    bool detect(const cv::Mat& gray, std::vector<cv::Point2f>& corners) {
+        corners.clear();
+        candidates_.clear();
+        if (gray.empty() || gray.type() != CV_8UC1)
+            return false;
+
+        computeResponse(gray);
+        findCandidates();
+        if ((int)candidates_.size() < kCorners)
+            return false;
+
+        const int seeds = std::min(params_.maxSeeds, (int)candidates_.size());
+        for (int s = 0; s < seeds; s++) {
+            if (growLattice(s) && extractBoard(corners)) {
+                refineCorners(gray, corners, patternSize(), refine_);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Candidate {
+        cv::Point2f pt;
+        float response;
+    };
+
+    // Largest lattice coordinate reachable from a seed inside the board.
+    static constexpr int kMaxDim = Cols > Rows ? Cols : Rows;
+    static constexpr int kSpan = 2 * kMaxDim - 1;
+    static constexpr int kOrigin = kMaxDim - 1;
+    static constexpr int kRingSamples = 16;
+
+    // -------------------------------------------------------------------------
+    void computeResponse(const cv::Mat& gray) {
+        // 8-bit smoothing with a +-2 sigma kernel is the fastest path through
+        // OpenCV's filters; the derivatives are taken in float.
+        const int ksize = 2 * (int)std::ceil(2.0 * params_.sigma) + 1;
+        cv::GaussianBlur(gray, smooth_, cv::Size(ksize, ksize), params_.sigma);
+        cv::Sobel(smooth_, ixx_, CV_32F, 2, 0, 3);
+        cv::Sobel(smooth_, iyy_, CV_32F, 0, 2, 3);
+        cv::Sobel(smooth_, ixy_, CV_32F, 1, 1, 3);
+        response_.create(gray.size(), CV_32F);
+        for (int y = 0; y < gray.rows; y++) {
+            const float* __restrict a = ixx_.ptr<float>(y);
+            const float* __restrict b = iyy_.ptr<float>(y);
+            const float* __restrict c = ixy_.ptr<float>(y);
+            float* __restrict r = response_.ptr<float>(y);
+            for (int x = 0; x < gray.cols; x++)
+                r[x] = c[x] * c[x] - a[x] * b[x];
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    void findCandidates() {
+        double maxResponse = 0;
+        cv::minMaxLoc(response_, nullptr, &maxResponse);
+        if (maxResponse <= 0)
+            return;
+        const float threshold = (float)(params_.relativeThreshold * maxResponse);
+        const int k = 2 * params_.nmsRadius + 1;
+        cv::dilate(response_, dilated_, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(k, k)));
+
+        const int ring = std::max(3, (int)std::lround(2.5 * params_.sigma));
+        std::array<cv::Point, kRingSamples> offsets;
+        for (int i = 0; i < kRingSamples; i++) {
+            const double a = 2.0 * CV_PI * i / kRingSamples;
+            offsets[i] = cv::Point((int)std::lround(ring * std::cos(a)), (int)std::lround(ring * std::sin(a)));
+        }
+
+        for (int y = ring; y < response_.rows - ring; y++) {
+            const float* r = response_.ptr<float>(y);
+            const float* d = dilated_.ptr<float>(y);
+            for (int x = ring; x < response_.cols - ring; x++) {
+                if (r[x] < threshold || r[x] < d[x])
+                    continue;
+                if (isXCorner(x, y, offsets))
+                    candidates_.push_back(Candidate{cv::Point2f((float)x, (float)y), r[x]});
+            }
+        }
+        // Strongest first: seeds are taken from the front.
+        std::sort(candidates_.begin(), candidates_.end(),
+                  [](const Candidate& a, const Candidate& b) { return a.response > b.response; });
+        const size_t cap = 4 * kCorners;
+        if (candidates_.size() > cap)
+            candidates_.resize(cap);
+    }
+
+    bool isXCorner(int x, int y, const std::array<cv::Point, kRingSamples>& offsets) const {
+        float v[kRingSamples], s[kRingSamples];
+        for (int i = 0; i < kRingSamples; i++)
+            v[i] = smooth_.at<uchar>(y + offsets[i].y, x + offsets[i].x);
+        float mean = 0, lo = v[0], hi = v[0];
+        for (int i = 0; i < kRingSamples; i++) {
+            s[i] = 0.25f * v[(i + kRingSamples - 1) % kRingSamples] + 0.5f * v[i] + 0.25f * v[(i + 1) % kRingSamples];
+            mean += s[i];
+            lo = std::min(lo, v[i]);
+            hi = std::max(hi, v[i]);
+        }
+        if (hi - lo < params_.minContrast)
+            return false;
+        mean /= kRingSamples;
+        int changes = 0;
+        for (int i = 0; i < kRingSamples; i++)
+            changes += (s[i] > mean) != (s[(i + 1) % kRingSamples] > mean);
+        return changes == 4;
+    }
+
+    // -------------------------------------------------------------------------
+    int nearestFree(const cv::Point2f& q, float radius) const {
+        int best = -1;
+        float bestD2 = radius * radius;
+        for (int i = 0; i < (int)candidates_.size(); i++) {
+            if (used_[i])
+                continue;
+            const cv::Point2f d = candidates_[i].pt - q;
+            const float d2 = d.dot(d);
+            if (d2 < bestD2) {
+                bestD2 = d2;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    int& cell(int i, int j) { return lattice_[(j + kOrigin) * kSpan + (i + kOrigin)]; }
+    bool inSpan(int i, int j) const { return std::abs(i) <= kOrigin && std::abs(j) <= kOrigin; }
+
+    // Grows a lattice from candidate 'seed'. Returns false when the lattice
+    // leaves the board's span, i.e. it cannot be this board.
+    bool growLattice(int seed) {
+        lattice_.fill(-1);
+        used_.assign(candidates_.size(), 0);
+        const cv::Point2f p0 = candidates_[seed].pt;
+        used_[seed] = 1;
+
+        // First axis: nearest candidate. Second axis: nearest one roughly
+        // perpendicular to the first.
+        int n1 = nearestFree(p0, 1e9f);
+        if (n1 < 0)
+            return false;
+        const cv::Point2f u = candidates_[n1].pt - p0;
+        const float lu = std::sqrt(u.dot(u));
+        int n2 = -1;
+        float best = 1e18f;
+        for (int i = 0; i < (int)candidates_.size(); i++) {
+            if (i == seed || i == n1)
+                continue;
+            const cv::Point2f d = candidates_[i].pt - p0;
+            const float ld = std::sqrt(d.dot(d));
+            if (ld < 0.5f * lu || ld > 2.0f * lu || std::fabs(d.dot(u)) > 0.5f * ld * lu)
+                continue;
+            if (ld < best) {
+                best = ld;
+                n2 = i;
+            }
+        }
+        if (n2 < 0)
+            return false;
+        const cv::Point2f v = candidates_[n2].pt - p0;
+        used_[n1] = used_[n2] = 1;
+        cell(0, 0) = seed;
+        cell(1, 0) = n1;
+        cell(0, 1) = n2;
+
+        std::array<cv::Point, kSpan * kSpan> queue;
+        int head = 0, tail = 0;
+        queue[tail++] = cv::Point(0, 0);
+        queue[tail++] = cv::Point(1, 0);
+        queue[tail++] = cv::Point(0, 1);
+        static const int dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        while (head < tail) {
+            const cv::Point at = queue[head++];
+            const cv::Point2f p = candidates_[cell(at.x, at.y)].pt;
+            for (const auto &dir : dirs) {
+                const int ni = at.x + dir[0], nj = at.y + dir[1];
+                if (inSpan(ni, nj) && cell(ni, nj) >= 0)
+                    continue;
+                const cv::Point2f step = predictStep(at.x, at.y, dir[0], dir[1], u, v);
+                const float len = std::sqrt(step.dot(step));
+                const int found = nearestFree(p + step, 0.35f * len);
+                if (found < 0)
+                    continue;
+                if (!inSpan(ni, nj))
+                    return false; // more corners in a row than the board has
+                used_[found] = 1;
+                cell(ni, nj) = found;
+                queue[tail++] = cv::Point(ni, nj);
+            }
+        }
+        return true;
+    }
+
+    // Step from (i, j) towards (i + di, j + dj), taken from the nearest
+    // placed neighbours so perspective is followed across the board.
+    cv::Point2f predictStep(int i, int j, int di, int dj, const cv::Point2f& u, const cv::Point2f& v) {
+        auto placed = [this](int a, int b) { return inSpan(a, b) && cell(a, b) >= 0; };
+        auto pt = [this](int a, int b) { return candidates_[cell(a, b)].pt; };
+        if (placed(i - di, j - dj))
+            return pt(i, j) - pt(i - di, j - dj);
+        // Same step one row/column over.
+        const int si = dj != 0 ? 1 : 0, sj = di != 0 ? 1 : 0;
+        for (int side = -1; side <= 1; side += 2) {
+            const int ai = i + side * si, aj = j + side * sj;
+            if (placed(ai, aj) && placed(ai + di, aj + dj))
+                return pt(ai + di, aj + dj) - pt(ai, aj);
+        }
+        return di != 0 ? u * (float)di : v * (float)dj;
+    }
+
+    // Checks the grown lattice is exactly the board and writes it out in
+    // the canonical order.
+    bool extractBoard(std::vector<cv::Point2f>& corners) {
+        int imin = kOrigin, imax = -kOrigin, jmin = kOrigin, jmax = -kOrigin, count = 0;
+        for (int j = -kOrigin; j <= kOrigin; j++) {
+            for (int i = -kOrigin; i <= kOrigin; i++) {
+                if (cell(i, j) < 0)
+                    continue;
+                imin = std::min(imin, i); imax = std::max(imax, i);
+                jmin = std::min(jmin, j); jmax = std::max(jmax, j);
+                count++;
+            }
+        }
+        if (count != kCorners)
+            return false;
+        const int w = imax - imin + 1, h = jmax - jmin + 1;
+        const bool alongI = (w == Cols && h == Rows);
+        if (!alongI && !(w == Rows && h == Cols))
+            return false;
+
+        // corner (r, c) -> lattice cell
+        auto latticePt = [&](int r, int c) {
+            return alongI ? candidates_[cell(imin + c, jmin + r)].pt : candidates_[cell(imin + r, jmin + c)].pt;
+        };
+        std::array<cv::Point2f, kCorners> grid;
+        for (int r = 0; r < Rows; r++)
+            for (int c = 0; c < Cols; c++)
+                grid[r * Cols + c] = latticePt(r, c);
+
+        // Handedness: columns x rows must turn like image x -> y.
+        const cv::Point2f cu = grid[1] - grid[0], cr = grid[Cols] - grid[0];
+        if (cu.x * cr.y - cu.y * cr.x < 0)
+            for (int r = 0; r < Rows; r++)
+                std::reverse(grid.begin() + r * Cols, grid.begin() + (r + 1) * Cols);
+
+        // 180 degree ambiguity. Square (0, 0) of the board is dark, so the
+        // square beyond each board corner has a known colour. Every corner
+        // whose squares are inside the image votes with its contrast against
+        // the neighbouring edge square.
+        const cv::Rect inside(0, 0, smooth_.cols, smooth_.rows);
+        float score = 0;
+        for (int k = 0; k < 4; k++) {
+            const int r = (k & 2) ? Rows - 1 : 0, c = (k & 1) ? Cols - 1 : 0;
+            const int su = c == 0 ? -1 : 1, sv = r == 0 ? -1 : 1;
+            const cv::Point2f p = grid[r * Cols + c];
+            const cv::Point2f eu = p - grid[r * Cols + c - su];      // outwards along the row
+            const cv::Point2f ev = p - grid[(r - sv) * Cols + c];    // outwards along the column
+            const cv::Point outer(p + 0.5f * (eu + ev)), edge(p + 0.5f * (ev - eu));
+            if (!inside.contains(outer) || !inside.contains(edge))
+                continue;
+            const float d = (float)smooth_.at<uchar>(outer) - (float)smooth_.at<uchar>(edge);
+            const bool dark = ((c == 0 ? 0 : Cols) + (r == 0 ? 0 : Rows)) % 2 == 0;
+            score += dark ? -d : d;
+        }
+        if (score < 0)
+            std::reverse(grid.begin(), grid.end());
+
+        corners.assign(grid.begin(), grid.end());
+        return true;
+    }
+
+    Params params_;
+    CornerRefineParams refine_;
+    cv::Mat smooth_, ixx_, iyy_, ixy_, response_, dilated_; // reused across frames (smooth_ is 8-bit)
+    std::vector<Candidate> candidates_;
+    std::vector<unsigned char> used_;
+    std::array<int, kSpan * kSpan> lattice_;
+};